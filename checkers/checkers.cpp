@@ -4,6 +4,8 @@
 #include <cstdlib>
 #include <cmath>
 #include <random>
+#include <thread>
+#include <functional>
 
 #define DEBUG_BOOL                  0   // If debugging, 1; Otherwise, 0
 
@@ -11,6 +13,8 @@ using std::make_tuple;
 using std::get;
 using std::tie;
 using std::remove;
+using std::sort;
+using std::find;
 using std::max;
 using std::min;
 using std::make_shared;
@@ -21,20 +25,49 @@ using std::endl;
 using namespace checkersVals;
 
 
-// Custom sorting function used to organize vectors based on the first location of the first tuple
+// Custom sorting function used to organize turns based on the start square of the first action
 // Used in playerMove()
-bool sortVecOfVecs( vector< tuple< tuple<int,int>, tuple<int,int> > > &, vector< tuple< tuple<int,int>, tuple<int,int> > > & );
+bool sortTurns( const turn &, const turn & );
 
-unsigned int states = 0;    // Used to check how many states minimax searched through
+// Returns the name of a square, e.g. b1
+// Used to output actions
+string squareName( int );
+
+// Returns the squares visited by a turn, e.g. c3-e5-c7
+string turnName( const turn & );
+
+// Returns the actions of a line, e.g. c3-d4 f6-e5
+string lineName( const actionLine & );
+
+// Converts a score between the transposition table and a search depth
+// Victory scores are penalized by their depth from the root, so they are stored relative to the position
+float scoreToTable( float, int );
+float scoreFromTable( float, int );
+
+// Converts an entry between a position and its mirror image
+// Scores are for Red, so the score is negated and its bound is reversed
+void mirrorEntry( tableEntry & );
+
+// Used to check how many states minimax searched through
+// Counted separately by each thread so games can be searched in parallel
+thread_local unsigned int states = 0;
 
 // If there is only one valid move, make it immediately
 // Used during minimax search to check if there is a single move available
 bool singleMove = true;
 
 // PRNG
-static std::mt19937 rng(std::chrono::steady_clock::now().time_since_epoch().count());
-static std::uniform_int_distribution<int> randChoice(0,1);
-static std::uniform_real_distribution<float> uid(0,0.1);
+// Each thread has its own generator, seeded with the time and the thread id
+static thread_local std::mt19937 rng( std::chrono::steady_clock::now().time_since_epoch().count()
+                                      ^ std::hash<std::thread::id>()( std::this_thread::get_id() ) );
+static thread_local std::uniform_int_distribution<int> randChoice(0,1);
+static thread_local std::uniform_real_distribution<float> uid(0,0.1);
+
+// Scores and searches have no randomness in deterministic mode
+bool board::deterministic = false;
+
+// Positions do not share table entries with their mirror images unless asked
+bool board::mirrorTable = false;
 
 
 ///////////////////////////////////// Piece /////////////////////////////////////
@@ -93,10 +126,6 @@ void board::piece::updateCount( board &owner, bool increment ) {
     else
         change = -1;
 
-    // Gets row and column of piece
-    int row,col;
-    tie( row, col ) = this->loc;
-
     // Updates counts
     if ( this->color == COLOR_RED_VAL ) {
 
@@ -121,33 +150,12 @@ void board::piece::updateCount( board &owner, bool increment ) {
 // Removes piece from board vectors and decrements piece counts
 void board::piece::clearPiece( board &owner ) {
 
-    // Gets row and column of piece
-    int row,col;
-    tie( row, col ) = this->loc;
-
-    // Removes piece from board move/jump sets
-    if ( this->validMove ) {
-
-        if ( this->color == COLOR_RED_VAL )
-            owner.redMoves.erase( owner.gameboard[row][col] );
-        else
-            owner.whiteMoves.erase( owner.gameboard[row][col] );
-
-    }
-
-    if ( this->validJump ) {
+    unsigned int keep = ~squareBit( this->loc );
 
-        if( this->color == COLOR_RED_VAL )
-            owner.redJumps.erase( owner.gameboard[row][col] );
-        else
-            owner.whiteJumps.erase( owner.gameboard[row][col] );
-
-    }
-
-    if ( this->color == COLOR_RED_VAL )
-        owner.redPieces.erase( owner.gameboard[row][col] );
-    else
-        owner.whitePieces.erase( owner.gameboard[row][col] );
+    // Removes piece from board piece/move/jump masks
+    owner.pieceMask[ this->color ] &= keep;
+    owner.moveMask[ this->color ] &= keep;
+    owner.jumpMask[ this->color ] &= keep;
 
     // Decrements piece counts
     this->updateCount( owner, false );
@@ -168,49 +176,39 @@ void board::piece::resetPiece() {
 
 
 // Checks if a piece should be promoted
+// Color is the color of the piece
+template< bool color >
 bool board::piece::checkPromotion( board &owner ) {
 
-    int row = get<0>(this->loc);
-    bool promo = false;
-
-    // Only continues if piece is a man
-    if ( this->type == TYPE_MAN_VAL ) {
-
-        // If piece should be promoted, update board counts
-        if ( this->color == COLOR_WHITE_VAL && row == 0 ) {
-
-            owner.whiteMen--;
-            owner.whiteKings++;
-            promo = true;
-
-        }
-        else if ( this->color == COLOR_RED_VAL && row == 7 ) {
+    // Only continues if piece is a man on its promotion row
+    if ( this->type != TYPE_MAN_VAL || !SQUARES.promotion[ color ][ this->loc ] )
+        return false;
 
-            owner.redMen--;
-            owner.redKings++;
-            promo = true;
+    // Update board counts
+    if ( color == COLOR_RED_VAL ) {
 
-        }
+        owner.redMen--;
+        owner.redKings++;
 
     }
+    else {
 
-    // If valid promotion, piece becomes king
-    if ( promo ) {
-
-        this->type = TYPE_KING_VAL;
-        return true;
+        owner.whiteMen--;
+        owner.whiteKings++;
 
     }
-    else
-        return false;
+
+    // Piece becomes king
+    this->type = TYPE_KING_VAL;
+    return true;
 
 }
 
 
 // Returns list of valid actions for a piece
-list< tuple<int,int> >* board::piece::returnActions() {
+pieceActions* board::piece::returnActions() {
 
-    list< tuple<int,int> > *possibleActions;
+    pieceActions *possibleActions;
 
     // If piece has a validJump, returns jump list
     if ( this->validJump )
@@ -227,16 +225,8 @@ list< tuple<int,int> >* board::piece::returnActions() {
 // Inserts piece into board move set
 void board::piece::insertMove( board &owner ) {
 
-    // Gets row and column of piece
-    int row,col;
-    tie( row, col ) = this->loc;
-
     this->validMove = true;
-
-    if ( this->color == COLOR_RED_VAL )
-        owner.redMoves.insert( owner.gameboard[row][col] );
-    else
-        owner.whiteMoves.insert( owner.gameboard[row][col] );
+    owner.moveMask[ this->color ] |= squareBit( this->loc );
 
 }
 
@@ -244,16 +234,8 @@ void board::piece::insertMove( board &owner ) {
 // Removes piece from board move set
 void board::piece::removeMove( board &owner ) {
 
-    // Gets row and column of piece
-    int row,col;
-    tie( row, col ) = this->loc;
-
     this->validMove = false;
-
-    if ( this->color == COLOR_RED_VAL )
-        owner.redMoves.erase( owner.gameboard[row][col] );
-    else
-        owner.whiteMoves.erase( owner.gameboard[row][col] );
+    owner.moveMask[ this->color ] &= ~squareBit( this->loc );
 
 }
 
@@ -261,16 +243,8 @@ void board::piece::removeMove( board &owner ) {
 // Inserts piece into board jump set
 void board::piece::insertJump( board &owner ) {
 
-    // Gets row and column of piece
-    int row,col;
-    tie( row, col ) = this->loc;
-
     this->validJump = true;
-
-    if ( this->color == COLOR_RED_VAL )
-        owner.redJumps.insert( owner.gameboard[row][col] );
-    else
-        owner.whiteJumps.insert( owner.gameboard[row][col] );
+    owner.jumpMask[ this->color ] |= squareBit( this->loc );
 
 }
 
@@ -278,16 +252,8 @@ void board::piece::insertJump( board &owner ) {
 // Removes piece from board jump set
 void board::piece::removeJump( board &owner ) {
 
-    // Gets row and column of piece
-    int row,col;
-    tie( row, col ) = this->loc;
-
     this->validJump = false;
-
-    if ( this->color == COLOR_RED_VAL )
-        owner.redJumps.erase( owner.gameboard[row][col] );
-    else
-        owner.whiteJumps.erase( owner.gameboard[row][col] );
+    owner.jumpMask[ this->color ] &= ~squareBit( this->loc );
 
 }
 
@@ -317,15 +283,11 @@ board::board() {
     emptyPiece = make_shared<piece>( piece(0,TYPE_EMPTY_VAL) );
     fillerPiece = make_shared<piece>( piece(FILLER_TRUE) );
 
-    tuple<int,int> tempLoc;
-
     // Loops through the entire board
     for ( int i=0; i<8; i++ ) {
 
         for ( int j=0; j<8; j++ ) {
 
-            tempLoc = make_tuple(i,j);  // Stores location of piece
-
             // Red occupies first 3 rows
             if ( i <= 2 ) {
 
@@ -334,7 +296,7 @@ board::board() {
 
                     // Initializes piece
                     gameboard[i][j] = make_shared<piece>( piece(COLOR_RED_VAL,TYPE_MAN_VAL) ); // Red Man
-                    gameboard[i][j]->loc = tempLoc;
+                    gameboard[i][j]->loc = toSquare(i,j);
 
                 }
                 else
@@ -349,7 +311,7 @@ board::board() {
 
                     // Initializes piece
                     gameboard[i][j] = make_shared<piece>( piece(COLOR_WHITE_VAL,TYPE_MAN_VAL) ); // White Man
-                    gameboard[i][j]->loc = tempLoc;
+                    gameboard[i][j]->loc = toSquare(i,j);
                     //whitePieces.insert( gameboard[i][j] );
 
                 }
@@ -408,62 +370,62 @@ void board::specialBoard() {
 
     // Double Corner Bottom Right
     gameboard[7][6] = make_shared<piece>( piece(COLOR_WHITE_VAL,TYPE_KING_VAL) );
-    gameboard[7][6]->loc = make_tuple(7,6);
+    gameboard[7][6]->loc = toSquare(7,6);
     gameboard[0][1] = make_shared<piece>( piece(COLOR_RED_VAL,TYPE_KING_VAL) );
-    gameboard[0][1]->loc = make_tuple(0,1);
+    gameboard[0][1]->loc = toSquare(0,1);
     gameboard[1][0] = make_shared<piece>( piece(COLOR_RED_VAL,TYPE_KING_VAL) );
-    gameboard[1][0]->loc = make_tuple(1,0);
+    gameboard[1][0]->loc = toSquare(1,0);
 
 
     /*
     // Double Corner Top Left
     gameboard[6][7] = make_shared<piece>( piece(COLOR_RED_VAL,TYPE_KING_VAL) );
-    gameboard[6][7]->loc = make_tuple(6,7);
+    gameboard[6][7]->loc = toSquare(6,7);
     gameboard[7][6] = make_shared<piece>( piece(COLOR_RED_VAL,TYPE_KING_VAL) );
-    gameboard[7][6]->loc = make_tuple(7,6);
+    gameboard[7][6]->loc = toSquare(7,6);
     gameboard[0][1] = make_shared<piece>( piece(COLOR_WHITE_VAL,TYPE_KING_VAL) );
-    gameboard[0][1]->loc = make_tuple(0,1);
+    gameboard[0][1]->loc = toSquare(0,1);
     */
 
     /*
     // Computer pruning optimal player double jump at certain depth ( 9-11 ) but not others?
     gameboard[3][2] = gameboard[2][1];
-    gameboard[3][2]->loc = make_tuple(3,2);
+    gameboard[3][2]->loc = toSquare(3,2);
     gameboard[2][1] = emptyPiece;
     gameboard[1][2] = gameboard[5][0];
-    gameboard[1][2]->loc = make_tuple(1,2);
+    gameboard[1][2]->loc = toSquare(1,2);
     gameboard[5][0] = emptyPiece;
     this->redTurn = true;
     */
     /*
     // Computer make double jump choice
     gameboard[3][0] = gameboard[1][0];
-    gameboard[3][0]->loc = make_tuple(3,0);
+    gameboard[3][0]->loc = toSquare(3,0);
     gameboard[1][0] = emptyPiece;
     gameboard[4][5] = gameboard[2][3];
-    gameboard[4][5]->loc = make_tuple(4,5);
+    gameboard[4][5]->loc = toSquare(4,5);
     gameboard[2][3] = emptyPiece;
 
     gameboard[4][1] = gameboard[6][1];
-    gameboard[4][1]->loc = make_tuple(4,1);
+    gameboard[4][1]->loc = toSquare(4,1);
     gameboard[6][1] = emptyPiece;
     gameboard[4][7] = gameboard[6][5];
-    gameboard[4][7]->loc = make_tuple(4,7);
+    gameboard[4][7]->loc = toSquare(4,7);
     gameboard[6][5] = emptyPiece;
     */
     /*
     // Double Jump
     gameboard[4][5] = gameboard[1][4];
-    gameboard[4][5]->loc = make_tuple(4,5);
+    gameboard[4][5]->loc = toSquare(4,5);
     gameboard[1][4] = emptyPiece;
     */
     /*
     // Two Possible Jumps
     gameboard[3][0] = gameboard[2][1];
-    gameboard[3][0]->loc = make_tuple(3,0);
+    gameboard[3][0]->loc = toSquare(3,0);
     //gameboard[3][4] = gameboard[2][5];
     gameboard[3][6] = gameboard[2][7];
-    gameboard[3][6]->loc = make_tuple(3,6);
+    gameboard[3][6]->loc = toSquare(3,6);
     gameboard[2][1] = emptyPiece;
     gameboard[1][2] = emptyPiece;
     gameboard[0][3] = emptyPiece;
@@ -472,7 +434,7 @@ void board::specialBoard() {
     gameboard[2][7] = emptyPiece;
 
     gameboard[4][3] = gameboard[5][2];
-    gameboard[4][3]->loc = make_tuple(4,3);
+    gameboard[4][3]->loc = toSquare(4,3);
     //gameboard[4][7] = gameboard[5][6];
     gameboard[5][2] = emptyPiece;
     //gameboard[5][6] = emptyPiece;
@@ -483,36 +445,68 @@ void board::specialBoard() {
 }
 
 
+// Loads piece counts, masks and actions for the pieces on the board
+// Used once the starting board is set
+void board::loadPieces() {
+
+    for ( int i=0; i<8; i++ ) {
+
+        for ( int j=0; j<8; j++ ) {
+
+            if ( gameboard[i][j]->filler == FILLER_FALSE && gameboard[i][j]->type != TYPE_EMPTY_VAL ) {
+
+                checkMoves( gameboard[i][j] );
+                gameboard[i][j]->updateCount( *this, true );
+                pieceMask[ gameboard[i][j]->color ] |= squareBit( gameboard[i][j]->loc );
+
+            }
+
+        }
+
+    }
+
+}
+
+
 // Plays the game
 void board::playGame() {
 
     printStart();   // Prints the start menu
 
+    // Search trees for each color
+    // Kept between turns so Monte Carlo Tree Search can reuse the subtree of the turns played
+    mctsTree trees[2];
+    turn playedTurn;
+
     // Infinite loop until an end state is reached
     while(1) {
 
         // If game is between 2 computers
         if ( AIvsAI )
-            computerMove();
+            playedTurn = computerMove( trees[ redTurn ? COLOR_RED_VAL : COLOR_WHITE_VAL ] );
         // Game is between player and computer
         else {
 
             // Computer is red
             // If red's turn, computer moves
             if ( redTurn )
-                computerMove();
+                playedTurn = computerMove( trees[ COLOR_RED_VAL ] );
             else
-                playerMove();
+                playedTurn = playerMove();
 
         }
 
+        trees[ COLOR_RED_VAL ].advance( playedTurn );
+        trees[ COLOR_WHITE_VAL ].advance( playedTurn );
+
     }
 
 }
 
 
 // Handles actions for computer
-void board::computerMove() {
+// Searches with the engine set for the current color and returns the turn played
+turn board::computerMove( mctsTree &tree ) {
 
     // Pauses the game to help AIvsAI debugging
     if ( DEBUG_BOOL && turnCount % 10 == 0 ) {
@@ -523,26 +517,106 @@ void board::computerMove() {
     }
     cout << "Computer is thinking..." << "\n" << endl;
 
+    int iterations = 0;
+    float futureScore;
+    actionLine futureMoves = searchMoves( tree, iterations, futureScore );
+
+    bool multiJump = true;
+    int actionNum = 0;
+    turn playedTurn;
+
+    // Performs actions from list of best actions
+    // Will loop if another jump is available
+    //      E.g. If action is a single move,
+    //           will not loop
+    while ( multiJump ) {
+
+        action curAction = futureMoves[ actionNum++ ];
+        playedTurn.actions.push_back( curAction );
+
+        multiJump = this->moveResult( curAction );
+        cout << "Move taken: " << squareName( actionStart(curAction) ) << " -> " << squareName( actionDestination(curAction) ) << "\n" << endl;
+        printBoard();
+
+    }
+
+    // Required statistics
+    if ( engine[ redTurn ? COLOR_RED_VAL : COLOR_WHITE_VAL ] == ENGINE_MINIMAX )
+        cout << "Maximum Depth: " << this->maxDepth << "\n";
+    else
+        cout << "Iterations: " << iterations << "\n";
+    cout << "Time Taken: " << ( this->elapsed_seconds ).count() << endl;
+
+    endTurn();
+
+    return playedTurn;
+
+}
+
+
+// Searches for the best actions with the engine set for the current color
+// Returns the actions leading to the best state found, starting with the current turn
+//      For minimax, also returns the score of that state through futureScore
+//      For Monte Carlo Tree Search, also returns the number of iterations through iterations
+actionLine board::searchMoves( mctsTree &tree, int &iterations, float &futureScore ) {
+
     // Stores bestMoves when a search to a depth has been fully completed
-    list< tuple< tuple<int,int>, tuple<int,int> > > futureMoves, tempMoves;
+    actionLine futureMoves, tempMoves;
 
     // Variables for minimax search
     this->startTime = std::chrono::system_clock::now(); // Keeps track of elapsed time
     this->maxDepth = 1;
-    float futureScore, tempScore = -12345;
+    float tempScore = -12345;
+    futureScore = 0;
     states = 0;
 
     // Check for single move
-    vector< tuple< tuple<int,int>, tuple<int,int> > > curVecOfActions;
-    this->getCurTurnActions( *this, curVecOfActions );
+    turnList turns;
+    turn bookTurn;
+    this->getCurTurnActions( *this, turn(), turns );
+
+    // Spends part of the time saved by book turns on this search
+    double extraTime = this->bankedTime / BOOK_BANK_TURNS;
 
     // Copy single move
-    if ( this->vecOfActions.size() == 1 )
-        std::copy( this->vecOfActions.front().begin(), this->vecOfActions.front().end(), std::back_inserter( futureMoves ) );
+    if ( turns.size() == 1 ) {
+
+        for ( action iter : turns.front().actions )
+            futureMoves.push_back( iter );
+
+    }
+
+    // Copy book turn
+    else if ( probeBook( turns, bookTurn ) ) {
+
+        for ( action iter : bookTurn.actions )
+            futureMoves.push_back( iter );
+
+        this->bankedTime += this->computerTime;
+
+    }
+
+    // Monte Carlo Tree Search
+    else if ( engine[ redTurn ? COLOR_RED_VAL : COLOR_WHITE_VAL ] != ENGINE_MINIMAX ) {
+
+        this->bankedTime -= extraTime;
+        this->computerTime += extraTime;
+
+        futureMoves = mctsSearch( tree, iterations );
+
+        this->computerTime -= extraTime;
+
+    }
 
     // Iterative deepening
     else {
 
+        this->bankedTime -= extraTime;
+        this->computerTime += extraTime;
+
+        searchTable->newSearch();
+        this->extensionsLeft = EXTENSION_BUDGET;
+
         while (1) {
 
             // Maximizing player if Red
@@ -557,8 +631,8 @@ void board::computerMove() {
                 cout << "Depth: " << this->maxDepth << "\n"
                      << "Score: " << tempScore << "\n";
 
-                for( auto iter : tempMoves )
-                    cout << char(get<0>(get<0>(iter))+97) << get<1>(get<0>(iter))+1 << " " << char(get<0>(get<1>(iter))+97) << get<1>(get<1>(iter))+1 << "\n";
+                for( action iter : tempMoves )
+                    cout << squareName( actionStart(iter) ) << " " << squareName( actionDestination(iter) ) << "\n";
                 cout << "\n";
 
             }
@@ -572,7 +646,7 @@ void board::computerMove() {
 
             // Only updates if a search was fully completed
             futureMoves = tempMoves;
-            futureScore = tempScore;    // Used for debugging
+            futureScore = tempScore;
 
             // If reached end of game
             if ( currentTerminalState( tempScore ) )
@@ -587,60 +661,224 @@ void board::computerMove() {
 
         }
 
+        // Plays the first turn if not even depth 1 could be searched in time
+        if ( futureMoves.empty() ) {
+
+            for ( action iter : turns.front().actions )
+                futureMoves.push_back( iter );
+
+        }
+
+        this->computerTime -= extraTime;
+
     }
 
     // Used to calculate time taken
     this->endTime = std::chrono::system_clock::now();
     this->elapsed_seconds = this->endTime - this->startTime;
 
+    // Writes the nodes of the search to the trace
+    if ( trace.enabled() )
+        trace.flush();
+
     // Used for debugging
     if ( DEBUG_BOOL ) {
 
         cout << "Best State: " << "\n";
 
         // Outputs a list of actions leading to optimal state
-        for( auto iter : futureMoves )
-            cout << char(get<0>(get<0>(iter))+97) << get<1>(get<0>(iter))+1 << " " << char(get<0>(get<1>(iter))+97) << get<1>(get<1>(iter))+1 << "\n";
+        for( action iter : futureMoves )
+            cout << squareName( actionStart(iter) ) << " " << squareName( actionDestination(iter) ) << "\n";
 
         cout << "Future Score: " << futureScore << "\n"
              << "Number of States: " << states << "\n" << "\n";
 
     }
 
-    bool multiJump = true;
+    return futureMoves;
 
-    // Performs actions from list of best actions
-    // Will loop if another jump is available
-    //      E.g. If action is a single move,
-    //           will not loop
-    while ( multiJump ) {
+}
 
-        multiJump = this->moveResult( get<0>( futureMoves.front() ), get<1>( futureMoves.front() ) );
-        cout << "Move taken: " << char(get<0>(get<0>( futureMoves.front() ))+97) << get<1>(get<0>(futureMoves.front()))+1 << " -> "
-             << char(get<0>(get<1>(futureMoves.front()))+97) << get<1>(get<1>(futureMoves.front()))+1 << "\n" << endl;
-        futureMoves.pop_front();    // Removes action that was just performed
-        printBoard();
+
+// Searches for the best turns by iterative deepening, each with an exact score and its line (multi-PV)
+// Returns up to numLines lines, from best to worst for the player to move, from the deepest depth fully searched
+// All lines share one iterative deepening run and the transposition table
+//      Each turn is searched with a window starting at the score of the worst line kept so far,
+//      so turns that cannot enter the lines fail low without being searched exactly
+vector< principalLine > board::searchLines( int numLines ) {
+
+    this->startTime = std::chrono::system_clock::now();
+    this->maxDepth = 1;
+    states = 0;
+
+    searchTable->newSearch();
+    this->extensionsLeft = EXTENSION_BUDGET;
+
+    turnList turns;
+    this->getCurTurnActions( *this, turn(), turns );
+
+    // Boards after each turn, searched from depth 1
+    //      Forced replies are extended as in minimax, by searching them one depth further,
+    //      so every line is searched to at least the reported depth and scores count depths from the root
+    vector< board > children;
+    vector< int > childExtensions;
+
+    for ( turn &iter : turns ) {
+
+        children.push_back( *this );
+
+        board &child = children.back();
+        child.applyTurn( iter );
+
+        for ( action curAction : iter.actions )
+            child.moves.push_back( curAction );
+
+        bool forced = child.redTurn ? child.forcedReply<COLOR_RED_VAL>() : child.forcedReply<COLOR_WHITE_VAL>();
+
+        if ( child.extensionsLeft > 0 && forced ) {
+
+            child.extensionsLeft--;
+            childExtensions.push_back( 1 );
+
+        }
+        else
+            childExtensions.push_back( 0 );
 
     }
 
-    // Required statistics
-    cout << "Maximum Depth: " << this->maxDepth << "\n"
-         << "Time Taken: " << ( this->elapsed_seconds ).count() << endl;
+    // Turns are searched in the order of their scores at the previous depth
+    vector< int > order( turns.size() );
+    vector< float > lastScores( turns.size(), 0 );
 
-    endTurn();
+    for ( int i=0; i<int( order.size() ); i++ )
+        order[i] = i;
+
+    vector< principalLine > lines, tempLines;
+    bool redBetter = this->redTurn;
+
+    // Checks if score a is better than score b for the player to move
+    auto better = [redBetter]( float a, float b ) { return redBetter ? a > b : a < b; };
+
+    while ( !turns.empty() ) {
+
+        tempLines.clear();
+        float bound = redBetter ? VAL_MIN : VAL_MAX;   // Score of the worst line kept, once numLines are kept
+        bool timeout = false;
+
+        for ( int index : order ) {
+
+            board tempBoard = children[ index ];
+            tempBoard.maxDepth = this->maxDepth + childExtensions[ index ];
+
+            tuple< float, actionLine > val;
+
+            if ( redBetter )
+                val = tempBoard.minimax( tempBoard, 1, tempBoard.redTurn, bound, VAL_MAX );
+            else
+                val = tempBoard.minimax( tempBoard, 1, tempBoard.redTurn, VAL_MIN, bound );
+
+            if ( get<0>( val ) == TIME_LIMIT_EXCEEDED ) {
+
+                timeout = true;
+                break;
+
+            }
+
+            lastScores[ index ] = get<0>( val );
+
+            // Scores that do not beat the bound failed low and are not exact
+            if ( !better( get<0>( val ), bound ) )
+                continue;
+
+            principalLine line;
+            line.rootTurn = turns[ index ];
+            line.score = get<0>( val );
+            line.moves = get<1>( val );
+
+            auto position = std::find_if( tempLines.begin(), tempLines.end(),
+                                          [&]( const principalLine &curLine ) { return better( line.score, curLine.score ); } );
+            tempLines.insert( position, line );
+
+            if ( int( tempLines.size() ) > numLines )
+                tempLines.pop_back();
+
+            if ( int( tempLines.size() ) == numLines )
+                bound = tempLines.back().score;
+
+        }
+
+        // Only updates if a search was fully completed
+        if ( timeout ) {
+
+            this->maxDepth--;
+            break;
+
+        }
+
+        lines = tempLines;
+
+        std::stable_sort( order.begin(), order.end(), [&]( int a, int b ) { return better( lastScores[a], lastScores[b] ); } );
+
+        // Stops once the best line reaches the end of the game, or at the same depth limit as searchMoves
+        if ( currentTerminalState( lines.front().score ) || this->maxDepth >= 20 )
+            break;
+
+        this->maxDepth++;
+
+    }
+
+    if ( trace.enabled() )
+        trace.flush();
+
+    return lines;
+
+}
+
+
+// Prints the best lines of a board file with the given player to move, given the time in seconds and the number of lines
+void board::multiPVFile( const string &fileName, bool redToMove, double seconds, int numLines ) {
+
+    board position;
+    position.loadBoardFile( fileName, redToMove );
+    position.computerTime = seconds;
+
+    if ( position.returnPieces() == 0 ) {
+
+        cout << "No moves available." << endl;
+        return;
+
+    }
+
+    vector< principalLine > lines = position.searchLines( numLines );
+
+    if ( lines.empty() ) {
+
+        cout << "Not enough time to search depth 1." << endl;
+        return;
+
+    }
+
+    cout << "Depth: " << position.maxDepth << "\n" << "\n";
+
+    for ( int i=0; i<int( lines.size() ); i++ )
+        cout << i+1 << ". " << turnName( lines[i].rootTurn ) << "  Score: " << lines[i].score << "  Line: " << lineName( lines[i].moves ) << "\n";
+
+    cout << endl;
 
 }
 
 
 // Handles player actions
-void board::playerMove() {
+// Returns the turn played
+turn board::playerMove() {
 
-    // Get vector of jumps
-    vector< tuple< tuple<int,int>, tuple<int,int> > > curVecOfActions, vecChosenActions;
-    this->getCurTurnActions( *this, curVecOfActions );
+    // Get list of turns
+    turnList turns;
+    turn chosenTurn;
+    this->getCurTurnActions( *this, turn(), turns );
 
-    // Cleans up the vector for the player
-    sort( this->vecOfActions.begin(), this->vecOfActions.end(), sortVecOfVecs );
+    // Cleans up the list for the player
+    sort( turns.begin(), turns.end(), sortTurns );
 
     bool validOption = false;
     int i, option;
@@ -654,14 +892,14 @@ void board::playerMove() {
         i=0;
 
         // Iterates through sequences of actions
-        for ( auto iter : this->vecOfActions ) {
+        for ( turn &iter : turns ) {
 
             // Prints starting piece
-            cout << i+1 << ": " << char( get<0>( get<0>( iter.front() ) )+97 ) << get<1>( get<0>( iter.front() ) )+1;
+            cout << i+1 << ": " << squareName( actionStart( iter.actions.front() ) );
 
             // Prints following pieces
-            for( auto iter2 : iter )
-                cout << " -> " << char( get<0>( get<1>( iter2 ) )+97 ) << get<1>( get<1>( iter2 ) )+1;
+            for( action iter2 : iter.actions )
+                cout << " -> " << squareName( actionDestination(iter2) );
 
             cout << "\n";
             i++;
@@ -705,7 +943,7 @@ void board::playerMove() {
 
         if ( 1 <= option && option <= i ) {
 
-            vecChosenActions = this->vecOfActions[ option-1 ];
+            chosenTurn = turns[ option-1 ];
             validOption = true;
 
         }
@@ -715,17 +953,18 @@ void board::playerMove() {
 
     }
 
-    for ( unsigned int j=0; j<vecChosenActions.size(); j++ ) {
+    for ( action curAction : chosenTurn.actions ) {
 
-        this->moveResult( get<0>( vecChosenActions[j] ), get<1>( vecChosenActions[j] ) );
-        cout << "Move taken: " << char(get<0>(get<0>( vecChosenActions[j] ))+97) << get<1>(get<0>(vecChosenActions[j]))+1 << " -> "
-             << char(get<0>(get<1>(vecChosenActions[j]))+97) << get<1>(get<1>(vecChosenActions[j]))+1 << "\n" << endl;
+        this->moveResult( curAction );
+        cout << "Move taken: " << squareName( actionStart(curAction) ) << " -> " << squareName( actionDestination(curAction) ) << "\n" << endl;
         this->printBoard();
 
     }
 
     endTurn();
 
+    return chosenTurn;
+
 }
 
 
@@ -737,6 +976,10 @@ void board::endTurn() {
     // Checks if score represents a terminal state
     if ( terminalState( this->score ) ) {
 
+        // Keeps the deep entries of the transposition table for later games, if a snapshot is used
+        if ( !snapshotFile.empty() )
+            saveTable( snapshotFile );
+
         // Outputs terminal state message
         if ( this->score == VICTORY_RED_MOVE )
             printVictory( COLOR_RED_VAL, true );
@@ -751,7 +994,6 @@ void board::endTurn() {
 
     // Resets stored moves
     this->moves.clear();
-    this->vecOfActions.clear();
 
     // Updates turn
     redTurn = !redTurn;
@@ -765,11 +1007,11 @@ void board::endTurn() {
         cout << "Red Men: " << redMen << "\n";
         cout << "Red King: " << redKings << "\n";
         cout << "Red Last: " << redLast << "\n";
-        cout << "Red Pieces: " << redPieces.size() << "\n";
+        cout << "Red Pieces: " << countSquares( pieceMask[ COLOR_RED_VAL ] ) << "\n";
         cout << "White Men: " << whiteMen << "\n";
         cout << "White King: " << whiteKings << "\n";
         cout << "White Last: " << whiteLast << "\n";
-        cout << "White Pieces: " << whitePieces.size() << "\n";
+        cout << "White Pieces: " << countSquares( pieceMask[ COLOR_WHITE_VAL ] ) << "\n";
 
     }
 
@@ -785,452 +1027,637 @@ void board::endTurn() {
 }
 
 
-// Updates vecOfActions, representing available actions during the current turn, including multi-jumps
-void board::getCurTurnActions( board &originalBoard, vector< tuple< tuple<int,int>, tuple<int,int> > > curVecOfJumps ) {
-
-    unordered_set< shared_ptr<piece> > possiblePieces = *( originalBoard.returnPieces() );
-    list< tuple<int,int> > *pieceActions;
-    vector< tuple< tuple<int,int>, tuple<int,int> > > tempVec;
+// Performs the actions of a turn and passes the move to the other player
+// Used to play boards out without printing them
+void board::applyTurn( const turn &curTurn ) {
 
-    bool multiJump;
-    board tempBoard;
+    for ( action curAction : curTurn.actions ) {
 
-    // Iterate through all pieces available to perform an action
-    for ( auto iter : possiblePieces ) {
+        this->isolateBoard( curAction );
+        this->moveResult( curAction );
 
-        pieceActions = iter->returnActions();
+    }
 
-        // Iterate through all actions available for the piece
-        for( auto iter2 : *pieceActions ) {
+    this->redTurn = !this->redTurn;
+    this->turnCount++;
 
-            // Copy originalBoard
-            tempBoard = originalBoard;
-            tempBoard.isolateBoard( iter->loc, iter2 );
+}
 
-            // Copy actions leading to originalBoard
-            tempVec = curVecOfJumps;
 
-            // Add current action to vector
-            tempVec.push_back( make_tuple( iter->loc, iter2 ) );
+// Returns the Zobrist key of the board
+unsigned long long board::hashKey() {
 
-            // Apply action
-            multiJump = tempBoard.moveResult( iter->loc, iter2 );
+    unsigned long long key = redTurn ? ZOBRIST.redTurn : 0;
 
-            if ( multiJump )
-                getCurTurnActions( tempBoard, tempVec );
-            else
-                tempBoard.vecOfActions.push_back( tempVec );
+    for ( int color=0; color<2; color++ ) {
 
+        for ( unsigned int mask = pieceMask[ color ]; mask; mask &= mask - 1 ) {
 
-            // Copy tempBoard vector of vectors of jumps
-            //      Should have one additional vector of jumps
-            originalBoard.vecOfActions = tempBoard.vecOfActions;
+            int square = firstSquare( mask );
+            key ^= ZOBRIST.piece[ color ][ squareAt( square )->type ][ square ];
 
         }
 
     }
 
+    return key;
+
 }
 
 
-// Handles alpha-beta pruning minimax search
-// Returns a score and a list of moves to reach the state with that score
-tuple< float, list< tuple< tuple<int,int>, tuple<int,int> > > > board::minimax( board &originalBoard, int depth, bool maxPlayer, float alpha, float beta ) {
+// Returns the key of the board in the evaluation cache
+// The heuristic uses the turn count (modulo 25) in the endgame, so it is mixed into the Zobrist key
+unsigned long long board::evalKey() {
 
-    // Counts number of states visited (because I was curious)
-    states++;
+    unsigned long long state = turnCount % 25;
 
-    // Updates elapsed time and returns if time limit is exceeded
-    this->endTime = std::chrono::system_clock::now();
-    this->elapsed_seconds = this->endTime - this->startTime;
+    return hashKey() ^ splitMix( state );
 
-    if ( this->computerTime - elapsed_seconds.count() < REMAINING_TIME_LIMIT )
-        return make_tuple( TIME_LIMIT_EXCEEDED, originalBoard.moves );
+}
 
-    // Reached max depth and starts returning from recursion
-    if ( depth == originalBoard.maxDepth ) {
 
-        //originalBoard.printBoard();
-        //cout << whitePieces.size();
-        //auto iter = whitePieces.begin();
-        //piece tempPiece = **iter;
-        //cout << char(get<0>( tempPiece.loc )+97) << get<1>(tempPiece.loc)+1 << "\n";
-        //cout << originalBoard.score << "\n";
+// Returns the Zobrist key of the mirror image of the board
+//      Colors are swapped, the board is rotated and the other player is to move
+unsigned long long board::mirrorKey() {
 
-        // Returns score for alpha-beta pruning
-        return returnFromLeaf( originalBoard, depth );
+    unsigned long long key = redTurn ? 0 : ZOBRIST.redTurn;
 
-    }
+    for ( int color=0; color<2; color++ ) {
 
-    unordered_set< shared_ptr<piece> > *possibleMoves = originalBoard.returnPieces();
-    list< tuple<int,int> > *possibleActions;
+        for ( unsigned int mask = pieceMask[ color ]; mask; mask &= mask - 1 ) {
 
-    // Return score of current board if there are no remaining moves
-    if ( possibleMoves->size() == 0 )
-        return returnFromLeaf( originalBoard, depth );
+            int square = firstSquare( mask );
+            key ^= ZOBRIST.piece[ !color ][ squareAt( square )->type ][ mirrorSquare( square ) ];
 
-    // Makes a copy of the parent board
-    board tempBoard;
+        }
 
-    bool multiJump;
-    tuple< float, list< tuple< tuple<int,int>, tuple<int,int> > > > val, bestVal;
+    }
 
-    if ( maxPlayer )
-        bestVal = make_tuple( VAL_MIN, originalBoard.moves );
-    else
-        bestVal = make_tuple( VAL_MAX, originalBoard.moves );
+    return key;
 
-    // Iterate through all actions
-    for ( auto iter : *possibleMoves ) {
+}
 
-        possibleActions = iter->returnActions();
 
-        for ( auto iter2 : *possibleActions ) {
+// Returns the canonical key of the board, the smaller of its Zobrist key and the key of its mirror image
+// A position and its mirror image share a canonical key, so results stored for one are found for the other
+//      mirrored is set if the key is the key of the mirror image, in which case scores and actions stored under it must be mirrored
+unsigned long long board::canonicalKey( bool &mirrored ) {
 
-            // Because board class contains pointers to pieces, copying board class copies the pointers
-            // Does not make copies of pieces, so pointers will still point to original pieces
-            // Need to "isolate" tempBoard from originalBoard because operations on tempBoard will
-            //      affect pieces of originalBoard through pointers
-            tempBoard = originalBoard;
-            tempBoard.isolateBoard( iter->loc, iter2 );
+    unsigned long long key = redTurn ? ZOBRIST.redTurn : 0;
+    unsigned long long mirroredKey = redTurn ? 0 : ZOBRIST.redTurn;
 
-            // Creates a tuple containing piece's old location and new location
-            // Adds to moves taken to reach current state
-            tempBoard.moves.push_back( make_tuple( iter->loc, iter2 ) );
-            multiJump = tempBoard.moveResult( iter->loc, iter2 );
+    for ( int color=0; color<2; color++ ) {
 
-            if ( multiJump )
-                val = tempBoard.minimax( tempBoard, depth, maxPlayer, alpha, beta );    // Same player as now
-            else {
+        for ( unsigned int mask = pieceMask[ color ]; mask; mask &= mask - 1 ) {
 
-                tempBoard.turnCount++;
-                tempBoard.redTurn = !(tempBoard.redTurn);
-                val = tempBoard.minimax( tempBoard, depth+1, !maxPlayer, alpha, beta ); // Switch players
+            int square = firstSquare( mask );
+            int type = squareAt( square )->type;
 
-            }
+            key ^= ZOBRIST.piece[ color ][ type ][ square ];
+            mirroredKey ^= ZOBRIST.piece[ !color ][ type ][ mirrorSquare( square ) ];
 
-            // Returns from depth if the time limited is exceeded
-            if ( get<0>( val ) == TIME_LIMIT_EXCEEDED )
-                return val;
+        }
 
-            // Alpha-beta Pruning
-            if ( maxPlayer ) {
+    }
 
-                // Get maximum of bestVal & val
-                if ( get<0>( bestVal ) < get<0>( val ) )
-                    bestVal = val;
+    mirrored = mirroredKey < key;
 
-                // Randomly choose if 2 states are equivalent
-                else if ( get<0>( bestVal ) == get<0>( val ) ) {
+    return mirrored ? mirroredKey : key;
 
-                    if ( randChoice(rng) )
-                        bestVal = val;
+}
 
-                }
 
-                // Pruning
-                // Returns bestVal+1 so subtree is pruned
-                if ( get<0>( bestVal ) >= beta )
-                    return make_tuple( get<0>( bestVal )+1, get<1>( bestVal ) );
+// Appends the available turns for the current player to turns, including multi-jumps
+//      curTurn holds the actions already taken during the turn
+void board::getCurTurnActions( board &originalBoard, turn curTurn, turnList &turns ) {
 
-                // Update alpha
-                alpha = max( alpha, get<0>( bestVal ) );
+    pieceActions *possibleActions;
+    turn tempTurn;
 
-            }
-            else {
+    bool multiJump;
+    board tempBoard;
 
-                // Get minimum of bestVal & val
-                if ( get<0>( bestVal ) > get<0>( val ) )
-                    bestVal = val;
+    // Iterate through all pieces available to perform an action
+    for ( unsigned int mask = originalBoard.returnPieces(); mask; mask &= mask - 1 ) {
 
-                // Randomly choose if 2 states are equivalent
-                else if ( get<0>( bestVal ) == get<0>( val ) ) {
+        possibleActions = originalBoard.squareAt( firstSquare( mask ) )->returnActions();
 
-                   if ( randChoice(rng) )
-                        bestVal = val;
+        // Iterate through all actions available for the piece
+        for( action iter2 : *possibleActions ) {
 
-                }
+            // Copy originalBoard
+            tempBoard = originalBoard;
+            tempBoard.isolateBoard( iter2 );
 
-                // Pruning
-                // Returns bestVal-1 so subtree is pruned
-                if ( get<0>( bestVal ) <= alpha )
-                    return make_tuple( get<0>( bestVal )-1, get<1>( bestVal ) );
+            // Copy actions leading to originalBoard
+            tempTurn = curTurn;
 
-                // Update beta
-                beta = min( beta, get<0>( bestVal ) );
+            // Add current action to turn
+            tempTurn.actions.push_back( iter2 );
+            if ( actionJump( iter2 ) )
+                tempTurn.captured |= 1u << actionCaptured( iter2 );
 
-            }
+            // Apply action
+            multiJump = tempBoard.moveResult( iter2 );
+
+            if ( multiJump )
+                getCurTurnActions( tempBoard, tempTurn, turns );
+            else
+                turns.push_back( tempTurn );
 
         }
 
     }
 
-    return bestVal;
+}
+
+
+// Handles alpha-beta pruning minimax search
+// Dispatches to the instantiation for the player to move
+//      Red is always the maximizing player
+tuple< float, actionLine > board::minimax( board &originalBoard, int depth, bool maxPlayer, float alpha, float beta ) {
+
+    if ( maxPlayer )
+        return minimax<COLOR_RED_VAL>( originalBoard, depth, alpha, beta );
+    else
+        return minimax<COLOR_WHITE_VAL>( originalBoard, depth, alpha, beta );
 
 }
 
 
-tuple< float, list< tuple< tuple<int,int>, tuple<int,int> > > > board::returnFromLeaf( board &originalBoard, int depth ) {
+// Handles alpha-beta pruning minimax search with the side to move given by color
+// Returns a score and a list of moves to reach the state with that score
+template< bool color >
+tuple< float, actionLine > board::minimax( board &originalBoard, int depth, float alpha, float beta ) {
 
-    originalBoard.heuristic();
+    // Counts number of states visited (because I was curious)
+    states++;
 
-    // Prolong loss
-    if ( terminalState( originalBoard.score ) ) {
+    // Updates elapsed time and returns if time limit is exceeded
+    this->endTime = std::chrono::system_clock::now();
+    this->elapsed_seconds = this->endTime - this->startTime;
 
-        // Penalize score based on depth
-        if ( originalBoard.score == VICTORY_RED_MOVE || originalBoard.score == VICTORY_RED_PIECE )
-            originalBoard.score -= depth;
-        else
-            originalBoard.score += depth;
+    if ( this->computerTime - elapsed_seconds.count() < REMAINING_TIME_LIMIT ) {
 
-    }
+        if ( trace.enabled() )
+            originalBoard.traceNode( alpha, beta, TIME_LIMIT_EXCEEDED, searchTrace::FLAG_TIMEOUT );
 
-    return make_tuple( originalBoard.score, originalBoard.moves );
+        return make_tuple( TIME_LIMIT_EXCEEDED, originalBoard.moves );
 
-}
+    }
 
+    // Reached max depth and starts returning from recursion
+    if ( depth == originalBoard.maxDepth ) {
 
-// Creates a copy of pieces potentially affected by an action from start to destination
-void board::isolateBoard( tuple<int,int> start, tuple<int,int> destination ) {
+        //originalBoard.printBoard();
+        //cout << whitePieces.size();
+        //auto iter = whitePieces.begin();
+        //piece tempPiece = **iter;
+        //cout << squareName( tempPiece.loc ) << "\n";
+        //cout << originalBoard.score << "\n";
 
-    int row,col;
-    list< shared_ptr<board::piece> > pieceList;
-    shared_ptr<piece> tempPiece;
+        // Returns score for alpha-beta pruning
+        if ( trace.enabled() ) {
+
+            tuple< float, actionLine > leafVal = returnFromLeaf( originalBoard, depth );
+            originalBoard.traceNode( alpha, beta, get<0>( leafVal ), searchTrace::FLAG_LEAF );
+            return leafVal;
 
-    // Gets a list of potential affected pieces
-    pieceList = affectedPieces( start, destination );
+        }
 
-    for ( auto iter : pieceList ) {
+        return returnFromLeaf( originalBoard, depth );
 
-        tie( row, col ) = iter->loc;
+    }
 
-        // Deletes pointers to old piece
-        iter->clearPiece(*this);
-        iter->updateCount(*this,true);
+    unsigned int possibleMoves = originalBoard.returnPieces<color>();
 
-        // Makes a copy of the piece
-        gameboard[row][col] = make_shared<piece>( piece(*iter) );
+    // Return score of current board if there are no remaining moves
+    if ( possibleMoves == 0 ) {
 
-        // Replaces with pointers to new piece
-        if ( iter->validMove ) {
+        if ( trace.enabled() ) {
 
-            if ( iter->color == COLOR_RED_VAL )
-                redMoves.insert( gameboard[row][col] );
-            else
-                whiteMoves.insert( gameboard[row][col] );
+            tuple< float, actionLine > leafVal = returnFromLeaf( originalBoard, depth );
+            originalBoard.traceNode( alpha, beta, get<0>( leafVal ), searchTrace::FLAG_LEAF );
+            return leafVal;
 
         }
 
-        if ( iter->validJump ) {
+        return returnFromLeaf( originalBoard, depth );
 
-            if ( iter->color == COLOR_RED_VAL )
-                redJumps.insert( gameboard[row][col] );
-            else
-                whiteJumps.insert( gameboard[row][col] );
+    }
 
-        }
+    ////////// Transposition Table //////////
+    // Boards in the middle of a multi-jump are not stored, since only the jumping piece can move
+    // With table mirroring, entries are stored by canonical key, in the orientation of the key
+    // Cutoffs are not taken at the root, or at nodes on the principal line, which need the full line
+    //      A node is on the principal line if its exact score lies inside the window, so the node would set the score of its parent
+    bool useTable = ( originalBoard.multiJumpMask == 0 );
+    int remainingDepth = originalBoard.maxDepth - depth;
+    unsigned long long key = 0;
+    bool mirrored = false;
+    action tableMove = 0;
+    float alphaStart = alpha, betaStart = beta;
+    int traceFlags = 0;
+    tableEntry entry;
 
-        if ( iter->color == COLOR_RED_VAL )
-            redPieces.insert( gameboard[row][col] );
-        else
-            whitePieces.insert( gameboard[row][col] );
+    if ( useTable ) {
+
+        key = mirrorTable ? originalBoard.canonicalKey( mirrored ) : originalBoard.hashKey();
+
+        if ( searchTable->probe( key, entry ) ) {
+
+            if ( mirrored )
+                mirrorEntry( entry );
+
+            tableMove = entry.move;
+            traceFlags |= searchTrace::FLAG_TABLE_HIT;
+
+            if ( depth > 0 && entry.depth >= remainingDepth ) {
+
+                float tableScore = scoreFromTable( entry.score, depth );
+
+                bool principal = ( entry.bound == transpositionTable::BOUND_EXACT && tableScore > alpha && tableScore < beta );
+
+                if ( ( entry.bound == transpositionTable::BOUND_EXACT && !principal )
+                     || ( entry.bound == transpositionTable::BOUND_LOWER && tableScore >= beta )
+                     || ( entry.bound == transpositionTable::BOUND_UPPER && tableScore <= alpha ) ) {
+
+                    if ( trace.enabled() )
+                        originalBoard.traceNode( alpha, beta, tableScore, traceFlags | searchTrace::FLAG_TABLE_CUTOFF );
+
+                    return make_tuple( tableScore, originalBoard.moves );
+
+                }
+
+            }
+
+        }
 
     }
 
-}
+    // Collects the actions of all pieces
+    // The best action found by an earlier search is tried first
+    fixedList< action, MAX_SIDE_ACTIONS > actions;
 
+    for ( ; possibleMoves; possibleMoves &= possibleMoves - 1 )
+        for ( action iter : *originalBoard.squareAt( firstSquare( possibleMoves ) )->returnActions() )
+            actions.push_back( iter );
 
-// Calculates pieces potentially affected by action
-    // Start tuple represents original location of piece
-    // End tuple represents new location after move
-list< shared_ptr<board::piece> > board::affectedPieces( tuple<int,int> start, tuple<int,int> destination ) {
+    if ( tableMove != 0 ) {
 
-    list< shared_ptr<board::piece> > pieceList;
-    int oldRow,oldCol,newRow,newCol,tempRow,tempCol;
-    tie( oldRow, oldCol ) = start;
-    tie( newRow, newCol ) = destination;
+        action *found = find( actions.begin(), actions.end(), tableMove );
 
-    int rowOffset = newRow - oldRow;
-    int colOffset = newCol - oldCol;
+        if ( found != actions.end() )
+            std::rotate( actions.begin(), found, found+1 );
 
-    if ( rowOffset > 0 )
-        rowOffset = 1;
-    else
-        rowOffset = -1;
+    }
+
+    // Makes a copy of the parent board
+    board tempBoard;
+
+    bool multiJump;
+    tuple< float, actionLine > val, bestVal;
+    action bestAction = 0;
 
-    if ( colOffset > 0 )
-        colOffset = 1;
+    if ( color == COLOR_RED_VAL )
+        bestVal = make_tuple( VAL_MIN, originalBoard.moves );
     else
-        colOffset = -1;
+        bestVal = make_tuple( VAL_MAX, originalBoard.moves );
+
+    // Iterate through all actions
+    for ( action iter2 : actions ) {
+
+        // Because board class contains pointers to pieces, copying board class copies the pointers
+        // Does not make copies of pieces, so pointers will still point to original pieces
+        // Need to "isolate" tempBoard from originalBoard because operations on tempBoard will
+        //      affect pieces of originalBoard through pointers
+        tempBoard = originalBoard;
+        tempBoard.isolateBoard( iter2 );
 
-    tempRow = oldRow - 2*rowOffset;
-    tempCol = oldCol - 2*colOffset;
-    int endRow = newRow + 2*rowOffset;
-    int endCol = newCol + 2*colOffset;
+        // Adds action to moves taken to reach current state
+        tempBoard.moves.push_back( iter2 );
+        multiJump = tempBoard.moveResult<color>( iter2 );
 
-    // Inserts pieces on same diagonal
-    while ( tempRow != endRow+rowOffset && tempCol != endCol+colOffset ) {
+        if ( multiJump )
+            val = tempBoard.minimax<color>( tempBoard, depth, alpha, beta );    // Same player as now
+        else {
+
+            tempBoard.turnCount++;
+            tempBoard.redTurn = !(tempBoard.redTurn);
+
+            // Forced replies are searched without using up depth, up to a budget for the line
+            if ( tempBoard.extensionsLeft > 0 && tempBoard.forcedReply<!color>() ) {
 
-        if ( validLoc(tempRow) && validLoc(tempCol) ) {
+                tempBoard.extensionsLeft--;
+                val = tempBoard.minimax<!color>( tempBoard, depth, alpha, beta );   // Switch players, same depth
 
-            if( gameboard[ tempRow ][ tempCol ]->type != TYPE_EMPTY_VAL )
-                pieceList.push_back(gameboard[ tempRow ][ tempCol ]);
+            }
+            else
+                val = tempBoard.minimax<!color>( tempBoard, depth+1, alpha, beta ); // Switch players
 
         }
 
-        tempRow += rowOffset;
-        tempCol += colOffset;
+        // Returns from depth if the time limited is exceeded
+        if ( get<0>( val ) == TIME_LIMIT_EXCEEDED ) {
 
-    }
+            if ( trace.enabled() )
+                originalBoard.traceNode( alphaStart, betaStart, TIME_LIMIT_EXCEEDED, traceFlags | searchTrace::FLAG_TIMEOUT );
 
-    int perpRowOffset = rowOffset;
-    int perpColOffset = colOffset * -1;
+            return val;
 
-    tempRow = oldRow + perpRowOffset;
-    tempCol = oldCol + perpColOffset;
-    endRow = newRow + perpRowOffset;
-    endCol = newCol + perpColOffset;
+        }
+
+        // Alpha-beta Pruning
+        if ( color == COLOR_RED_VAL ) {
+
+            // Get maximum of bestVal & val
+            if ( get<0>( bestVal ) < get<0>( val ) ) {
 
-    for ( int i=0; i<2; i++ ) {
+                bestVal = val;
+                bestAction = iter2;
 
-        for( int j=0; j<2; j++ ) {
+            }
 
-            while ( tempRow != endRow+rowOffset && tempCol != endCol+colOffset ) {
+            // Randomly choose if 2 states are equivalent
+            else if ( get<0>( bestVal ) == get<0>( val ) ) {
 
-                if ( validLoc(tempRow) && validLoc(tempCol) ) {
+                if ( !deterministic && randChoice(rng) ) {
 
-                    if ( gameboard[tempRow][tempCol]->type != TYPE_EMPTY_VAL )
-                        pieceList.push_back(gameboard[tempRow][tempCol]);
+                    bestVal = val;
+                    bestAction = iter2;
 
                 }
 
-                tempRow += rowOffset;
-                tempCol += colOffset;
+            }
+
+            // Pruning
+            // Returns bestVal+1 so subtree is pruned
+            if ( get<0>( bestVal ) >= beta ) {
+
+                if ( useTable )
+                    storeResult( key, mirrored, get<0>( bestVal ), bestAction, depth, remainingDepth, alphaStart, betaStart );
+
+                if ( trace.enabled() )
+                    originalBoard.traceNode( alphaStart, betaStart, get<0>( bestVal )+1, traceFlags | searchTrace::FLAG_CUTOFF );
+
+                return make_tuple( get<0>( bestVal )+1, get<1>( bestVal ) );
 
             }
 
-            tempRow = oldRow + 2*perpRowOffset;
-            tempCol = oldCol + 2*perpColOffset;
-            endRow = newRow + 2*perpRowOffset;
-            endCol = newCol + 2*perpColOffset;
+            // Update alpha
+            alpha = max( alpha, get<0>( bestVal ) );
 
         }
+        else {
+
+            // Get minimum of bestVal & val
+            if ( get<0>( bestVal ) > get<0>( val ) ) {
+
+                bestVal = val;
+                bestAction = iter2;
+
+            }
+
+            // Randomly choose if 2 states are equivalent
+            else if ( get<0>( bestVal ) == get<0>( val ) ) {
+
+               if ( !deterministic && randChoice(rng) ) {
 
-        perpRowOffset *= -1;
-        perpColOffset *= -1;
-        tempRow = oldRow + perpRowOffset;
-        tempCol = oldCol + perpColOffset;
-        endRow = newRow + perpRowOffset;
-        endCol = newCol + perpColOffset;
+                    bestVal = val;
+                    bestAction = iter2;
+
+               }
+
+            }
+
+            // Pruning
+            // Returns bestVal-1 so subtree is pruned
+            if ( get<0>( bestVal ) <= alpha ) {
+
+                if ( useTable )
+                    storeResult( key, mirrored, get<0>( bestVal ), bestAction, depth, remainingDepth, alphaStart, betaStart );
+
+                if ( trace.enabled() )
+                    originalBoard.traceNode( alphaStart, betaStart, get<0>( bestVal )-1, traceFlags | searchTrace::FLAG_CUTOFF );
+
+                return make_tuple( get<0>( bestVal )-1, get<1>( bestVal ) );
+
+            }
+
+            // Update beta
+            beta = min( beta, get<0>( bestVal ) );
+
+        }
 
     }
 
-    return pieceList;
+    if ( useTable )
+        storeResult( key, mirrored, get<0>( bestVal ), bestAction, depth, remainingDepth, alphaStart, betaStart );
+
+    if ( trace.enabled() )
+        originalBoard.traceNode( alphaStart, betaStart, get<0>( bestVal ), traceFlags );
+
+    return bestVal;
 
 }
 
 
-// Returns set of pieces that can take an action
-unordered_set< shared_ptr<board::piece> >* board::returnPieces() {
+// Stores the result of a search in the transposition table
+// The bound is found from the alpha-beta window the search started with
+//      Bounds are widened by 1, since pruned subtrees return scores shifted by 1
+void board::storeResult( unsigned long long key, bool mirrored, float bestScore, action bestAction, int depth, int remainingDepth, float alpha, float beta ) {
 
-    int jumpLen;
-    unordered_set< shared_ptr<board::piece> > *possibleMoves;
+    tableEntry entry;
+    entry.move = bestAction;
+    entry.depth = remainingDepth;
 
-    // A multiJump is when a jump took place and the same piece is available for another jump
-    // Stores a pointer to that piece
-    // Should contain a piece only if previous action was a jump and piece has oppoprtunity for another jump
-    jumpLen = multiJumps.size();
+    if ( bestScore <= alpha ) {
 
-    // If multiJump is not available
-    if ( jumpLen == 0 ) {
+        entry.bound = transpositionTable::BOUND_UPPER;
+        bestScore += 1;
 
-        // Checks for board jump set size
-        // If board jump set is empty, no valid jumps
-            // Will return board move set
-        // If board jump set is not empty, valid jumps
-            // Will return board jump set
-        if ( redTurn ) {
+    }
+    else if ( bestScore >= beta ) {
 
-            jumpLen = redJumps.size();
-            if( jumpLen == 0 )
-                possibleMoves = &redMoves;
-            else
-                possibleMoves = &redJumps;
+        entry.bound = transpositionTable::BOUND_LOWER;
+        bestScore -= 1;
 
-        }
-        else {
+    }
+    else
+        entry.bound = transpositionTable::BOUND_EXACT;
 
-            jumpLen = whiteJumps.size();
-            if( jumpLen == 0 )
-                possibleMoves = &whiteMoves;
-            else
-                possibleMoves = &whiteJumps;
+    entry.score = scoreToTable( bestScore, depth );
 
-        }
+    if ( mirrored )
+        mirrorEntry( entry );
+
+    searchTable->store( key, entry );
+
+}
+
+
+tuple< float, actionLine > board::returnFromLeaf( board &originalBoard, int depth ) {
+
+    originalBoard.heuristic();
+
+    // Prolong loss
+    if ( terminalState( originalBoard.score ) ) {
+
+        // Penalize score based on depth
+        if ( originalBoard.score == VICTORY_RED_MOVE || originalBoard.score == VICTORY_RED_PIECE )
+            originalBoard.score -= depth;
+        else
+            originalBoard.score += depth;
 
     }
 
-    // If multiJump is available
+    return make_tuple( originalBoard.score, originalBoard.moves );
+
+}
+
+
+// Creates a copy of pieces potentially affected by an action
+void board::isolateBoard( action curAction ) {
+
+    // The board masks are copied along with the board, so only the pieces themselves need to be copied
+    for ( unsigned int mask = affectedPieces( curAction ); mask; mask &= mask - 1 ) {
+
+        shared_ptr<piece> &curSquare = squareAt( firstSquare( mask ) );
+        curSquare = make_shared<piece>( piece(*curSquare) );
+
+    }
+
+}
+
+
+// Calculates pieces potentially affected by action
+unsigned int board::affectedPieces( action curAction ) {
+
+    // Looks up the squares around the diagonal of the action and keeps the occupied ones
+    return SQUARES.affected[ actionStart( curAction ) ][ actionDirection( curAction ) ][ actionJump( curAction ) ]
+           & ( pieceMask[ COLOR_RED_VAL ] | pieceMask[ COLOR_WHITE_VAL ] );
+
+}
+
+
+// Returns mask of pieces that can take an action
+unsigned int board::returnPieces() {
+
+    if ( redTurn )
+        return returnPieces<COLOR_RED_VAL>();
+    else
+        return returnPieces<COLOR_WHITE_VAL>();
+
+}
+
+
+// Returns mask of pieces that can take an action for the side given by color
+template< bool color >
+unsigned int board::returnPieces() {
+
+    // A multiJump is when a jump took place and the same piece is available for another jump
+    // Should contain a piece only if previous action was a jump and piece has oppoprtunity for another jump
+    if ( multiJumpMask )
+        return multiJumpMask;
+
+    // If board jump mask is empty, no valid jumps
+        // Will return board move mask
+    // If board jump mask is not empty, valid jumps
+        // Will return board jump mask
+    if ( jumpMask[ color ] == 0 )
+        return moveMask[ color ];
     else
-        possibleMoves = &multiJumps;
+        return jumpMask[ color ];
+
+}
+
 
-    return possibleMoves;
+// Checks if the player of a color has no choice of reply
+// Captures are mandatory, so any capture forces the reply, as does a single move
+template< bool color >
+bool board::forcedReply() {
+
+    if ( jumpMask[ color ] != 0 )
+        return true;
+
+    unsigned int pieces = moveMask[ color ];
+
+    return countSquares( pieces ) == 1 && squareAt( firstSquare( pieces ) )->moves.size() == 1;
 
 }
 
 
 // Performs a specified action
-    // Start tuple represents original location of piece
-    // End tuple represents new location after move
 // If there is another valid jump available, return true; otherwise, return false
-bool board::moveResult( tuple<int,int> start, tuple<int,int> destination ) {
+bool board::moveResult( action curAction ) {
 
-    int oldRow,oldCol,newRow,newCol;
-    tie( oldRow, oldCol ) = start;
-    tie( newRow, newCol ) = destination;
+    if ( redTurn )
+        return moveResult<COLOR_RED_VAL>( curAction );
+    else
+        return moveResult<COLOR_WHITE_VAL>( curAction );
+
+}
+
+
+// Performs a specified action for a piece of the given color
+template< bool color >
+bool board::moveResult( action curAction ) {
+
+    int start = actionStart( curAction );
+    int destination = actionDestination( curAction );
 
     // Checks if piece is making a jump
     bool jump,tempBool;
-    jump = gameboard[ oldRow ][ oldCol ]->validJump;
+    jump = actionJump( curAction );
+
+    shared_ptr<piece> &curPiece = squareAt( destination );
 
     // Moves the piece pointer from original location to new location
-    gameboard[ newRow ][ newCol ] = gameboard[ oldRow ][ oldCol ];
+    curPiece = squareAt( start );
+
+    // Moves the piece in the board masks
+    // Move/jump bits are recalculated by checkMoves below
+    pieceMask[ color ] = ( pieceMask[ color ] & ~squareBit( start ) ) | squareBit( destination );
+    moveMask[ color ] &= ~squareBit( start );
+    jumpMask[ color ] &= ~squareBit( start );
 
     // Updates the location of piece
-    gameboard[ newRow ][ newCol ]->loc = destination;
-    tempBool = gameboard[ newRow ][ newCol ]->checkPromotion(*this);
+    curPiece->loc = destination;
+    tempBool = curPiece->checkPromotion<color>(*this);
 
     // Reset piece and calculate valid actions in new location
-    gameboard[ newRow ][ newCol ]->resetPiece();
+    curPiece->resetPiece();
 
     // Piece is no longer in original location, so replace with empty piece
-    gameboard[ oldRow ][ oldCol ] = emptyPiece;
+    squareAt( start ) = emptyPiece;
 
     // If piece made a jump, remove captured piece
     if ( jump ) {
 
         // Calculate location of captured piece
-        int jumpRow = oldRow + (newRow - oldRow)/2;
-        int jumpCol = oldCol + (newCol - oldCol)/2;
+        int captured = actionCaptured( curAction );
 
         // Remove piece from board sets and decrement counts
-        gameboard[ jumpRow ][ jumpCol ]->clearPiece(*this);
+        squareAt( captured )->clearPiece(*this);
 
         // Replace captured piece pointer with empty piece pointer
-        gameboard[ jumpRow ][ jumpCol ] = emptyPiece;
+        squareAt( captured ) = emptyPiece;
 
     }
 
     // Checks if any diagonal pieces were affected by action taken
         // E.g. If a piece was captured, a piece diagonal to it
         //      may be able to move to the captured piece's location
-    checkDiagMoves( gameboard[ newRow ][ newCol ], start, jump );
+    checkDiagMoves<color>( curPiece, curAction );
 
     // Checks actions for piece in new location
-    checkMoves( gameboard[ newRow ][ newCol ] );
+    if ( curPiece->type == TYPE_KING_VAL )
+        checkMoves<color,TYPE_KING_VAL>( curPiece );
+    else
+        checkMoves<color,TYPE_MAN_VAL>( curPiece );
 
-    // Empty the multiJump set after every move
-    multiJumps.clear();
+    // Empty the multiJump mask after every move
+    multiJumpMask = 0;
 
     // Ends turn after promotion
     if ( tempBool )
@@ -1240,9 +1667,9 @@ bool board::moveResult( tuple<int,int> start, tuple<int,int> destination ) {
         return false;
 
     // Continue turn if piece has another jump available
-    if ( gameboard[ newRow ][ newCol ]->validJump ) {
+    if ( curPiece->validJump ) {
 
-        multiJumps.insert( gameboard[ newRow ][ newCol ] );
+        multiJumpMask = squareBit( destination );
         return true;
 
     }
@@ -1256,74 +1683,74 @@ bool board::moveResult( tuple<int,int> start, tuple<int,int> destination ) {
 // Checks actions of a specific piece
 void board::checkMoves( shared_ptr<piece> &curPiece ) {
 
-    int row,col;
-    tie( row, col ) = curPiece->loc;
+    if ( curPiece->color == COLOR_RED_VAL ) {
 
-    shared_ptr<piece> tempPiece;
-    tuple<int,int> tempTuple;
-
-    int rowOffset = 1;
-    int colOffset = 1;
+        if ( curPiece->type == TYPE_KING_VAL )
+            checkMoves<COLOR_RED_VAL,TYPE_KING_VAL>( curPiece );
+        else
+            checkMoves<COLOR_RED_VAL,TYPE_MAN_VAL>( curPiece );
 
-    int newRow,newCol,jumpRow,jumpCol;
-    bool canMove = false;
-    bool canJump = false;
+    }
+    else {
 
-    // Loops through all 4 diagonal directions of a piece
-    for ( int i=0; i<2; i++ ) {
+        if ( curPiece->type == TYPE_KING_VAL )
+            checkMoves<COLOR_WHITE_VAL,TYPE_KING_VAL>( curPiece );
+        else
+            checkMoves<COLOR_WHITE_VAL,TYPE_MAN_VAL>( curPiece );
 
-        rowOffset *= -1;
-        for ( int j=0; j<2; j++ ) {
+    }
 
-            colOffset *= -1;
-            // Location of piece after potential move
-            newRow = row + rowOffset;
-            newCol = col + colOffset;
+}
 
-            // Checks if newRow & newCol are on the board
-            if ( validLoc(newRow) && validLoc(newCol) ) {
 
-                tempPiece = gameboard[ newRow ][ newCol ];
+// Checks actions of a piece of the given color and type
+// Men only look in their forward directions; kings look in all 4
+template< bool color, int type >
+void board::checkMoves( shared_ptr<piece> &curPiece ) {
 
-                // Checks if curPiece can move in the direction of rowOffset
-                if ( curPiece->validDirection( rowOffset ) ) {
+    // Up directions are 0-1, Down directions are 2-3
+    constexpr int firstDir = ( type == TYPE_MAN_VAL && color == COLOR_RED_VAL ) ? 2 : 0;
+    constexpr int lastDir = ( type == TYPE_MAN_VAL && color == COLOR_WHITE_VAL ) ? 1 : 3;
 
-                    // Checks for moves
-                    // Only possible if tempPiece is an empty piece
-                    if ( tempPiece->type == TYPE_EMPTY_VAL ) {
+    int square = curPiece->loc;
+    int newSquare, jumpSquare;
+    piece *tempPiece;
 
-                        tempTuple = make_tuple( newRow, newCol );
-                        curPiece->moves.push_back( tempTuple );
-                        canMove = true;
+    bool canMove = false;
+    bool canJump = false;
 
-                    }
-                    // Checks for jumps
-                    // Only possible if curPiece and tempPiece are different colors
-                    else if ( curPiece->color != tempPiece->color ) {
+    // Loops through the diagonal directions the piece can move in
+    for ( int dir=firstDir; dir<=lastDir; dir++ ) {
 
-                        // Location of piece after potential jump
-                        jumpRow = row + 2*rowOffset;
-                        jumpCol = col + 2*colOffset;
+        // Location of piece after potential move
+        newSquare = SQUARES.neighbour[ square ][ dir ];
 
-                        // Checks if jumpRow & jumpCol are on the board
-                        if ( validLoc(jumpRow) && validLoc(jumpCol) ) {
+        // Checks if newSquare is on the board
+        if ( newSquare == NO_SQUARE )
+            continue;
 
-                            tempPiece = gameboard[ jumpRow ][ jumpCol ];
+        tempPiece = squareAt( newSquare ).get();
 
-                            // Jump is only possible if location after potential jump is empty
-                            if ( tempPiece->type == TYPE_EMPTY_VAL ) {
+        // Checks for moves
+        // Only possible if tempPiece is an empty piece
+        if ( tempPiece->type == TYPE_EMPTY_VAL ) {
 
-                                tempTuple = make_tuple( jumpRow, jumpCol );
-                                curPiece->jumps.push_back(tempTuple);
-                                canJump = true;
+            curPiece->moves.push_back( makeAction( square, newSquare, false ) );
+            canMove = true;
 
-                            }
+        }
+        // Checks for jumps
+        // Only possible if curPiece and tempPiece are different colors
+        else if ( tempPiece->color != color ) {
 
-                        }
+            // Location of piece after potential jump
+            jumpSquare = SQUARES.landing[ square ][ dir ];
 
-                    }
+            // Jump is only possible if location after potential jump is on the board and empty
+            if ( jumpSquare != NO_SQUARE && squareAt( jumpSquare )->type == TYPE_EMPTY_VAL ) {
 
-                }
+                curPiece->jumps.push_back( makeAction( square, jumpSquare, true ) );
+                canJump = true;
 
             }
 
@@ -1353,87 +1780,77 @@ void board::checkMoves( shared_ptr<piece> &curPiece ) {
 
 
 // Checks actions of pieces affected by curPiece's move
-void board::checkDiagMoves( shared_ptr<piece> &curPiece, tuple<int,int> oldLoc, bool jump ) {
-
-    int oldRow,oldCol,newRow,newCol,tempRow,tempCol,row,col,jumpRow,jumpCol;
-    tie( oldRow, oldCol ) = oldLoc;
-    tuple<int,int> newLoc = curPiece->loc;
-    tie( newRow, newCol ) = newLoc;
-
-    shared_ptr<piece> tempPiece,jumpPiece;
-    tuple<int,int> curLoc = oldLoc;
+// Color is the color of curPiece (the side that moved)
+template< bool color >
+void board::checkDiagMoves( shared_ptr<piece> &curPiece, action curAction ) {
 
-    int rowOffset = 1;
-    int colOffset = 1;
+    bool jump = actionJump( curAction );
+    int newSquare = curPiece->loc;
+    int square, tempSquare, jumpSquare;
+    piece *tempPiece, *jumpPiece;
 
-    row = oldRow;
-    col = oldCol;
+    // Squares vacated by the action
+    //      The original square, and the captured piece's square if the piece jumped
+    int vacated[2] = { actionStart( curAction ), actionCaptured( curAction ) };
 
     // Updates pieces around old square
     for ( int loop=0; loop<(1+jump); loop++ ) {
 
-        for(int i=0; i<2; i++) {
-
-            rowOffset *= -1;
-            for(int j=0; j<2; j++) {
-
-                colOffset *= -1;
-                tempRow = row + rowOffset;
-                tempCol = col + colOffset;
-
-                if ( validLoc(tempRow) && validLoc(tempCol) ) {
+        square = vacated[ loop ];
 
-                    if ( tempRow == newRow && tempCol == newCol ) // Ensure no duplicate moves
-                        continue;
+        for ( int dir=0; dir<NUM_DIRECTIONS; dir++ ) {
 
-                    tempPiece = gameboard[ tempRow ][ tempCol ];
+            // Direction from a neighbouring piece back to square
+            int backDir = oppositeDirection( dir );
 
-                    if ( tempPiece->type == TYPE_EMPTY_VAL )
-                        continue;
+            tempSquare = SQUARES.neighbour[ square ][ dir ];
 
-                    if ( tempPiece->validDirection(rowOffset*-1) ) {
+            if ( tempSquare == NO_SQUARE || tempSquare == newSquare ) // Ensure no duplicate moves
+                continue;
 
-                        tempPiece->moves.push_back(curLoc);
-                        if ( tempPiece->validMove == false )
-                            tempPiece->insertMove(*this);
+            tempPiece = squareAt( tempSquare ).get();
 
-                        if ( tempPiece->validJump == true ) {
+            if ( tempPiece->type == TYPE_EMPTY_VAL )
+                continue;
 
-                            tuple<int,int> tempTuple = make_tuple(row+(rowOffset*-1),col+(colOffset*-1));
-                            tempPiece->jumps.remove(tempTuple);
-                            if ( tempPiece->jumps.size() == 0 )
-                                tempPiece->removeJump(*this);
+            if ( tempPiece->validDirection( directionRow( backDir ) ) ) {
 
-                        }
+                tempPiece->moves.push_back( makeAction( tempSquare, square, false ) );
+                if ( tempPiece->validMove == false )
+                    tempPiece->insertMove(*this);
 
-                    }
+                // tempPiece can no longer jump over square
+                if ( tempPiece->validJump == true ) {
 
-                    jumpRow = row + 2*rowOffset;
-                    jumpCol = col + 2*colOffset;
+                    int oldJump = SQUARES.neighbour[ square ][ backDir ];
 
-                    if ( validLoc(jumpRow) && validLoc(jumpCol) ) {
+                    if ( oldJump != NO_SQUARE )
+                        tempPiece->jumps.remove( makeAction( tempSquare, oldJump, true ) );
+                    if ( tempPiece->jumps.size() == 0 )
+                        tempPiece->removeJump(*this);
 
-                        if ( jumpRow == newRow && jumpCol == newCol ) // Ensure no duplicate moves
-                            continue;
+                }
 
-                        jumpPiece = gameboard[ jumpRow ][ jumpCol ];
+            }
 
-                        if ( jumpPiece->type == TYPE_EMPTY_VAL )
-                            continue;
+            jumpSquare = SQUARES.landing[ square ][ dir ];
 
-                        if ( jumpPiece->validDirection(rowOffset*-1) ) {
+            if ( jumpSquare == NO_SQUARE || jumpSquare == newSquare ) // Ensure no duplicate moves
+                continue;
 
-                            if ( jumpPiece->color != tempPiece->color ) {
+            jumpPiece = squareAt( jumpSquare ).get();
 
-                                if ( jumpPiece->validJump == false )
-                                    jumpPiece->insertJump(*this);
-                                jumpPiece->jumps.push_back( curLoc );
+            if ( jumpPiece->type == TYPE_EMPTY_VAL )
+                continue;
 
-                            }
+            // jumpPiece can now jump over tempPiece into square
+            if ( jumpPiece->validDirection( directionRow( backDir ) ) ) {
 
-                        }
+                if ( jumpPiece->color != tempPiece->color ) {
 
-                    }
+                    if ( jumpPiece->validJump == false )
+                        jumpPiece->insertJump(*this);
+                    jumpPiece->jumps.push_back( makeAction( jumpSquare, square, true ) );
 
                 }
 
@@ -1441,114 +1858,129 @@ void board::checkDiagMoves( shared_ptr<piece> &curPiece, tuple<int,int> oldLoc,
 
         }
 
-        if ( jump ) {
+    }
 
-            row += ( newRow - oldRow )/2;
-            col += ( newCol - oldCol )/2;
-            curLoc = make_tuple( row, col );
+    // Update pieces around new square
+    square = newSquare;
 
-        }
+    for ( int dir=0; dir<NUM_DIRECTIONS; dir++ ) {
 
-    }
+        int backDir = oppositeDirection( dir );
 
-    // Update pieces around new square
-    rowOffset = 1;
-    colOffset = 1;
+        tempSquare = SQUARES.neighbour[ square ][ dir ];
 
-    row = newRow;
-    col = newCol;
-    curLoc = newLoc;
+        if ( tempSquare == NO_SQUARE )
+            continue;
 
-    for ( int i=0; i<2; i++ ) {
+        tempPiece = squareAt( tempSquare ).get();
 
-        rowOffset *= -1;
-        for ( int j=0; j<2; j++ ) {
+        if ( tempPiece->type == TYPE_EMPTY_VAL )
+            continue;
 
-            colOffset *= -1;
-            tempRow = row + rowOffset;
-            tempCol = col + colOffset;
+        if ( tempPiece->validDirection( directionRow( backDir ) ) ) {
 
-            if ( validLoc(tempRow) && validLoc(tempCol) ) {
+            if ( tempPiece->validMove == true ) {
 
-                tempPiece = gameboard[ tempRow ][ tempCol ];
+                action *tempIter = find( tempPiece->moves.begin(), tempPiece->moves.end(), makeAction( tempSquare, square, false ) );
 
-                if ( tempPiece->type == TYPE_EMPTY_VAL )
-                    continue;
+                if ( tempIter != tempPiece->moves.end() ) { // If tempPiece has a move to square
 
-                if ( tempPiece->validDirection(rowOffset*-1) ) {
+                    tempPiece->moves.erase( tempIter );
+                    if ( tempPiece->moves.empty() )
+                        tempPiece->removeMove(*this);
 
-                    if ( tempPiece->validMove == true ) {
+                }
 
-                        auto tempIter = find( tempPiece->moves.begin(), tempPiece->moves.end(), curLoc );
+            }
 
-                        if ( tempIter != tempPiece->moves.end() ) { // If tempPiece has a move to curLoc
+            // tempPiece may now be able to jump over curPiece
+            if ( tempPiece->color != color ) {
 
-                            tempPiece->moves.erase( tempIter );
-                            if ( tempPiece->moves.empty() )
-                                tempPiece->removeMove(*this);
+                jumpSquare = SQUARES.neighbour[ square ][ backDir ];
 
-                        }
+                if ( jumpSquare != NO_SQUARE && squareAt( jumpSquare )->type == TYPE_EMPTY_VAL ) {
 
-                    }
+                    if ( tempPiece->validJump == false )
+                        tempPiece->insertJump(*this);
+                    tempPiece->jumps.push_back( makeAction( tempSquare, jumpSquare, true ) );
 
-                    if ( tempPiece->color != curPiece->color ) {
+                }
 
-                        jumpRow = row + (-1*rowOffset);
-                        jumpCol = col + (-1*colOffset);
+            }
 
-                        if ( validLoc(jumpRow) && validLoc(jumpCol) ) {
+        }
 
-                            if ( gameboard[jumpRow][jumpCol]->type == TYPE_EMPTY_VAL ) {
+        jumpSquare = SQUARES.landing[ square ][ dir ];
 
-                                if ( tempPiece->validJump == false )
-                                    tempPiece->insertJump(*this);
-                                tempPiece->jumps.push_back( make_tuple( jumpRow, jumpCol ) );
+        if ( jumpSquare != NO_SQUARE ) {
 
-                            }
+            jumpPiece = squareAt( jumpSquare ).get();
 
-                        }
+            if ( jumpPiece->type == TYPE_EMPTY_VAL )
+                continue;
 
-                    }
+            // jumpPiece can no longer jump over tempPiece into square
+            if ( jumpPiece->validDirection( directionRow( backDir ) ) ) {
 
-                }
+                if ( jumpPiece->color != tempPiece->color ) {
 
-                jumpRow = row + 2*rowOffset;
-                jumpCol = col + 2*colOffset;
+                    jumpPiece->jumps.remove( makeAction( jumpSquare, square, true ) );
+                    if ( jumpPiece->jumps.empty() )
+                        jumpPiece->removeJump(*this);
 
-                if ( validLoc(jumpRow) && validLoc(jumpCol) ) {
+                }
 
-                    jumpPiece = gameboard[ jumpRow ][ jumpCol ];
+            }
 
-                    if ( jumpPiece->type == TYPE_EMPTY_VAL )
-                        continue;
+        }
 
-                    if ( jumpPiece->validDirection(rowOffset*-1) ) {
+    }
 
-                        if ( jumpPiece->color != tempPiece->color ) {
+}
 
-                            jumpPiece->jumps.remove( curLoc );
-                            if ( jumpPiece->jumps.empty() )
-                                jumpPiece->removeJump(*this);
 
-                        }
+// Turns table mirroring on or off
+// Entries are stored in the orientation of their key either way, so a table filled in one mode can be used in the other
+void board::setMirrorTable( bool enabled ) {
 
-                    }
+    mirrorTable = enabled;
 
-                }
+}
 
-            }
 
-        }
+// Turns deterministic mode on or off
+// Cached scores may have been computed in the other mode, so the cache is cleared
+void board::setDeterministic( bool enabled ) {
 
-    }
+    deterministic = enabled;
+    evals.clear();
 
 }
 
 
 // Calculates score for current board state
+// Scores are cached by position, so a position reached again is not scored again
+void board::heuristic() {
+
+    unsigned long long key = evalKey();
+
+    if ( searchEvals->probe( key, this->score ) )
+        return;
+
+    if ( redTurn )
+        heuristic<COLOR_RED_VAL>();
+    else
+        heuristic<COLOR_WHITE_VAL>();
+
+    searchEvals->store( key, this->score );
+
+}
+
+
+// Calculates score for current board state with the side to move given by color
+template< bool color >
 void board::heuristic() {
 
-    int row,col;
     int whiteCount = whiteMen + whiteKings;
     int redCount = redMen + redKings;
 
@@ -1568,9 +2000,9 @@ void board::heuristic() {
     }
 
     // No moves remaining
-    if ( redTurn ) {
+    if ( color == COLOR_RED_VAL ) {
 
-        if( redMoves.size() + redJumps.size() == 0 ) {
+        if( ( moveMask[ COLOR_RED_VAL ] | jumpMask[ COLOR_RED_VAL ] ) == 0 ) {
 
             this->score = VICTORY_WHITE_MOVE;   // White Victory
             return;
@@ -1580,7 +2012,7 @@ void board::heuristic() {
     }
     else {
 
-        if ( whiteMoves.size() + whiteJumps.size() == 0 ) {
+        if ( ( moveMask[ COLOR_WHITE_VAL ] | jumpMask[ COLOR_WHITE_VAL ] ) == 0 ) {
 
             this->score = VICTORY_RED_MOVE;     // Red Victory
             return;
@@ -1612,60 +2044,14 @@ void board::heuristic() {
     int whiteCorner = 0;
     int redCorner = 0;
 
-    this->whiteLast = 0;
-    this->redLast = 0;
-
     whiteScore += whiteMen * menValue;
     whiteScore += whiteKings * kingValue;
     redScore += redMen * menValue;
     redScore += redKings * kingValue;
 
     // Calculates Corner, Last, and Closest
-    for ( auto iter : whitePieces ) {
-
-        tie( row, col ) = iter->loc;
-        if ( iter->type == TYPE_MAN_VAL ) {
-
-            whiteScore += pow((float(7 - row)/2), 2)/2;
-            if( row == 7 )
-                whiteLast++;
-
-        }
-        else {
-
-            // Adds a score corresponding to how close the farthest king is
-            whiteClosest += addKingDist( iter );
-            whiteCornerDist += kingDistance( iter );
-
-            if ( row+col == 1 || row+col == 13 )
-                whiteCorner++;
-
-        }
-
-    }
-
-    for ( auto iter : redPieces ) {
-
-        tie( row, col ) = iter->loc;
-        if ( iter->type == TYPE_MAN_VAL ) {
-
-            redScore += pow( (float(row)/2), 2 )/2;
-            if ( row == 0 )
-                redLast++;
-
-        }
-        else {
-
-            // Adds a score corresponding to how close the farthest king is
-            redClosest += addKingDist( iter );
-            redCornerDist += kingDistance( iter );
-
-            if ( row+col == 1 || row+col == 13)
-                redCorner++;
-
-        }
-
-    }
+    sideScore<COLOR_WHITE_VAL>( whiteScore, this->whiteLast, whiteClosest, whiteCornerDist, whiteCorner );
+    sideScore<COLOR_RED_VAL>( redScore, this->redLast, redClosest, redCornerDist, redCorner );
 
     // Only favors having last row men if there are at least 8 pieces left
     if ( whiteCount >= 8 )
@@ -1724,45 +2110,92 @@ void board::heuristic() {
     }
 
     // Add randomness to the score
-    redScore += uid(rng);
-    whiteScore += uid(rng);
+    if ( !deterministic ) {
+
+        redScore += uid(rng);
+        whiteScore += uid(rng);
+
+    }
 
     this->score = redScore - whiteScore;
 
 }
 
 
+// Adds the positional score of the pieces of the given color
+//      Men are scored by how far they have advanced and whether they guard the last row
+//      Kings are scored by how close they are to enemy pieces and the double corners
+template< bool color >
+void board::sideScore( float &pieceScore, int &last, float &closest, float &cornerDist, int &corner ) {
+
+    int row,col;
+
+    last = 0;
+
+    for ( unsigned int mask = pieceMask[ color ]; mask; mask &= mask - 1 ) {
+
+        shared_ptr<piece> &iter = squareAt( firstSquare( mask ) );
+
+        row = SQUARES.row[ iter->loc ];
+        col = SQUARES.col[ iter->loc ];
+        if ( iter->type == TYPE_MAN_VAL ) {
+
+            // Distance travelled from the last row
+            int advance = ( color == COLOR_RED_VAL ) ? row : 7 - row;
+
+            pieceScore += pow( (float(advance)/2), 2 )/2;
+            if ( row == side<color>::lastRow )
+                last++;
+
+        }
+        else {
+
+            // Adds a score corresponding to how close the farthest king is
+            closest += addKingDist<color>( iter );
+            cornerDist += kingDistance<color>( iter );
+
+            if ( row+col == 1 || row+col == 13 )
+                corner++;
+
+        }
+
+    }
+
+}
+
+
+template< bool color >
 float board::addKingDist( shared_ptr<piece> &curPiece ) {
 
     float score = 0;
 
-    int oppositeColor = !curPiece->color;
+    const int oppositeColor = !color;
 
     // Check each corner
     if ( ( ( gameboard[0][1]->color == oppositeColor ) && ( gameboard[0][1]->type == TYPE_KING_VAL ) )
         || ( ( gameboard[1][0]->color == oppositeColor ) && ( gameboard[1][0]->type == TYPE_KING_VAL ) ) ) {
 
-        if ( curPiece->loc == make_tuple( 2,3 ) || curPiece->loc == make_tuple( 3,2 ) )
+        if ( curPiece->loc == toSquare( 2,3 ) || curPiece->loc == toSquare( 3,2 ) )
             score = 5;
-        else if ( curPiece->loc == make_tuple( 0,3 ) || curPiece->loc == make_tuple( 3,0 ) )
+        else if ( curPiece->loc == toSquare( 0,3 ) || curPiece->loc == toSquare( 3,0 ) )
             score = 7.5;
 
     }
     if ( ( ( gameboard[6][7]->color == oppositeColor ) && ( gameboard[6][7]->type == TYPE_KING_VAL ) )
         || ( ( gameboard[7][6]->color == oppositeColor ) && ( gameboard[7][6]->type == TYPE_KING_VAL ) ) ) {
 
-        if ( curPiece->loc == make_tuple( 4,5 ) || curPiece->loc == make_tuple( 5,4 ) )
+        if ( curPiece->loc == toSquare( 4,5 ) || curPiece->loc == toSquare( 5,4 ) )
             score = 5;
-        else if ( get<0>(curPiece->loc) == 0 || get<1>(curPiece->loc) == 0 )
+        else if ( SQUARES.row[ curPiece->loc ] == 0 || SQUARES.col[ curPiece->loc ] == 0 )
             score = -2.5;
-        else if ( curPiece->loc == make_tuple( 4,7 ) || curPiece->loc == make_tuple( 7,4 ) )
+        else if ( curPiece->loc == toSquare( 4,7 ) || curPiece->loc == toSquare( 7,4 ) )
             score = 7.5;
 
     }
 
 
     // Factorial-like function that gives a smaller bonus as king gets closer to a piece
-    for ( int i=kingDistance( curPiece ); i<=6; i++ )
+    for ( int i=kingDistance<color>( curPiece ); i<=6; i++ )
         score += float(i) / 16;
 
     return score;
@@ -1773,24 +2206,22 @@ float board::addKingDist( shared_ptr<piece> &curPiece ) {
 // Calculates distance of closest piece from king
 // Returns int representing how far away the closest piece is
 // Smaller int = closer
+template< bool color >
 int board::kingDistance( shared_ptr<piece> &curPiece ) {
 
-    unordered_set< shared_ptr<piece> > *pieceSet;
     int curRow,curCol,tempRow,tempCol,tempMin,rowDiff,colDiff;
     int minDistance = 6;
 
-    tie( curRow, curCol ) = curPiece->loc;
+    curRow = SQUARES.row[ curPiece->loc ];
+    curCol = SQUARES.col[ curPiece->loc ];
 
-    // Gets set of pieces of opposite color
-    if ( curPiece->color == COLOR_RED_VAL )
-        pieceSet = &whitePieces;
-    else
-        pieceSet = &redPieces;
+    // Iterates through all pieces of opposite color to find the closest piece
+    for ( unsigned int mask = pieceMask[ !color ]; mask; mask &= mask - 1 ) {
 
-    // Iterates through all pieces to find the closest piece
-    for ( auto iter : *pieceSet ) {
+        int square = firstSquare( mask );
 
-        tie( tempRow, tempCol ) = iter->loc;
+        tempRow = SQUARES.row[ square ];
+        tempCol = SQUARES.col[ square ];
         rowDiff = abs( tempRow - curRow );
         colDiff = abs( tempCol - curCol );
         tempMin = (rowDiff + colDiff)/2;
@@ -1863,18 +2294,92 @@ bool board::validateInput() {
 }
 
 
-// Custom sorting function used to organize vectors based on the first location of the first tuple
-bool sortVecOfVecs( vector< tuple< tuple<int,int>, tuple<int,int> > > &vecA, vector< tuple< tuple<int,int>, tuple<int,int> > > &vecB ) {
+// Custom sorting function used to organize turns based on the start square of the first action
+//      Squares are numbered row by row, so this orders by row, then column
+bool sortTurns( const turn &turnA, const turn &turnB ) {
 
-    int rowA, colA, rowB, colB;
-    tie( rowA, colA ) = get<0>( vecA[0] );
-    tie( rowB, colB ) = get<0>( vecB[0] );
+    return actionStart( turnA.actions[0] ) < actionStart( turnB.actions[0] );
 
-    if ( rowA < rowB )
-        return true;
-    else if ( rowA == rowB )
-        return colA < colB;
-    else
-        return false;
+}
+
+
+// Returns the name of a square, e.g. b1
+string squareName( int square ) {
+
+    return string( 1, char( SQUARES.row[ square ]+97 ) ) + std::to_string( SQUARES.col[ square ]+1 );
+
+}
+
+
+// Returns the squares visited by a turn, e.g. c3-e5-c7
+string turnName( const turn &curTurn ) {
+
+    string name = squareName( actionStart( curTurn.actions.front() ) );
+
+    for ( action iter : curTurn.actions )
+        name += "-" + squareName( actionDestination( iter ) );
+
+    return name;
+
+}
+
+
+// Returns the actions of a line, e.g. c3-d4 f6-e5
+string lineName( const actionLine &line ) {
+
+    string name;
+
+    for ( action iter : line ) {
+
+        if ( !name.empty() )
+            name += " ";
+
+        name += squareName( actionStart( iter ) ) + "-" + squareName( actionDestination( iter ) );
+
+    }
+
+    return name;
+
+}
+
+
+// Converts a score found at a search depth to the score stored in the transposition table
+float scoreToTable( float score, int depth ) {
+
+    if ( score > 9900 )
+        return score + depth;
+    else if ( score < -9900 )
+        return score - depth;
+
+    return score;
+
+}
+
+
+// Converts a score stored in the transposition table to the score at a search depth
+float scoreFromTable( float score, int depth ) {
+
+    if ( score > 9900 )
+        return score - depth;
+    else if ( score < -9900 )
+        return score + depth;
+
+    return score;
+
+}
+
+
+// Converts an entry between a position and its mirror image
+void mirrorEntry( tableEntry &entry ) {
+
+    entry.score = -entry.score;
+
+    if ( entry.move != 0 )
+        entry.move = mirrorAction( entry.move );
+
+    if ( entry.bound == transpositionTable::BOUND_LOWER )
+        entry.bound = transpositionTable::BOUND_UPPER;
+    else if ( entry.bound == transpositionTable::BOUND_UPPER )
+        entry.bound = transpositionTable::BOUND_LOWER;
 
 }
@@ -4,15 +4,21 @@
 #include <string>
 #include <list>
 #include <vector>
-#include <unordered_set>
 #include <tuple>
 #include <memory>
 #include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <iosfwd>
 
 using std::string;
 using std::list;
 using std::vector;
-using std::unordered_set;
 using std::tuple;
 using std::shared_ptr;
 
@@ -25,11 +31,64 @@ namespace checkersVals {
     #define VAL_MIN                     -99999.0f
     #define VAL_MAX                     99999.0f
 
+    #define EXTENSION_BUDGET            4           // Forced replies a line can be extended by
+
     #define VICTORY_RED_PIECE           10000
     #define VICTORY_RED_MOVE            9999
     #define VICTORY_WHITE_PIECE         -10000
     #define VICTORY_WHITE_MOVE          -9999
 
+    // Monte Carlo Tree Search
+    #define MCTS_EXPLORATION            1.0f        // UCT exploration constant
+    #define MCTS_VIRTUAL_LOSS           3           // Losses added to a node while a thread searches below it
+    #define MCTS_EXPAND_VISITS          1           // Visits needed before a leaf is expanded
+    #define MCTS_MAX_NODES              1000000     // Capacity of the node arena
+    #define MCTS_ROLLOUT_LIMIT          200         // Turns played in a rollout before it is scored by the heuristic
+    #define MCTS_ROLLOUT_MARGIN         30          // Heuristic score needed to count an unfinished rollout as a win
+    #define MCTS_ROLLOUT_EPSILON        0.1f        // Chance of a random turn in a heuristic-biased rollout
+
+    // Engine Matches
+    #define MATCH_MAX_TURNS             200         // Turns played before a game is adjudicated as a draw
+    #define MATCH_OPENING_TURNS         4           // Random turns played to create each opening
+    #define SPRT_ALPHA                  0.05        // Chance of accepting elo1 when elo0 is true
+    #define SPRT_BETA                   0.05        // Chance of accepting elo0 when elo1 is true
+
+    // Opening Book
+    #define BOOK_FILE                   "openingBook.bin"
+    #define BOOK_MAGIC                  "CKRBOOK"   // Identifies a book file
+    #define BOOK_VERSION                1           // Changed whenever the book format or the hash keys change
+    #define BOOK_BANK_TURNS             10          // Turns over which time saved by book turns is spent
+
+    // Transposition Table
+    #define TABLE_ENTRIES               ( 1 << 20 ) // Entries in the transposition table, must be a power of 2
+    #define TABLE_FILE                  "transpositionTable.bin"
+    #define TABLE_SNAPSHOT_FILE         "tableSnapshot.bin"
+    #define TABLE_MAGIC                 "CKRTABL"   // Identifies a table file
+    #define TABLE_SNAPSHOT_MAGIC        "CKRSNAP"   // Identifies a snapshot file
+    #define TABLE_VERSION               2           // Changed whenever the table format, the hash keys or the heuristic change
+    #define TABLE_SNAPSHOT_DEPTH        6           // Depth an entry needs to be kept in a snapshot
+
+    // Evaluation Cache
+    #define EVAL_CACHE_ENTRIES          ( 1 << 18 ) // Entries in the evaluation cache, must be a power of 2
+
+    // Search Trace
+    #define TRACE_MAGIC                 "CKRTRCE"   // Identifies a trace file
+    #define TRACE_VERSION               1           // Changed whenever the trace format changes
+    #define TRACE_BUFFER_RECORDS        65536       // Records buffered by each thread before they are written
+
+    // Analysis Daemon
+    #define DAEMON_PORT                 7777        // Default localhost port
+    #define DAEMON_WORKERS              16          // Least number of threads answering requests and helping their searches
+    #define DAEMON_POLL_MS              10          // Longest wait for new requests while others are being answered, in milliseconds
+    #define DAEMON_MAX_REQUEST          4096        // Longest request line accepted, in bytes
+
+    // Proof-Number Search
+    #define SOLVE_NODES                 10000000    // Positions expanded before the solver gives up
+    #define SOLVE_ENTRIES               ( 1 << 21 ) // Positions kept in the solver's table before it gives up
+    #define SOLVE_FIRST_TURNS           10          // Turns a forced win may take in the first iteration of the solver
+    #define SOLVE_MAX_TURNS             100         // Turns a forced win may take, counting the turns of both players
+    #define SOLVE_INFINITY              100000000u  // Proof or disproof number of a solved position
+
 
     const bool COLOR_RED_VAL = 0;     // Red
     const bool COLOR_WHITE_VAL = 1;   // White
@@ -41,8 +100,314 @@ namespace checkersVals {
     const bool FILLER_FALSE = 0;      // Piece
     const bool FILLER_TRUE = 1;       // Filler (squares that pieces cannot move on)
 
+    const int ENGINE_MINIMAX = 0;           // Alpha-beta minimax with iterative deepening
+    const int ENGINE_MCTS_RANDOM = 1;       // Monte Carlo Tree Search with random rollouts
+    const int ENGINE_MCTS_HEURISTIC = 2;    // Monte Carlo Tree Search with heuristic-biased rollouts
+    const int NUM_ENGINES = 3;
+
+    const int SOLVE_UNKNOWN = 0;    // A budget ran out before the result was proven
+    const int SOLVE_WIN = 1;        // The player to move can force a win
+    const int SOLVE_LOSS = 2;       // The other player can force a win
+    const int SOLVE_DRAW = 3;       // Neither player can force a win within SOLVE_MAX_TURNS turns
+
+
+    // Side-specific constants, resolved at compile time
+    template< bool color >
+    struct side {
+
+        static constexpr int forward = ( color == COLOR_RED_VAL ) ? 1 : -1;     // Row offset of a man's move
+        static constexpr int promotionRow = ( color == COLOR_RED_VAL ) ? 7 : 0; // Row where a man is promoted
+        static constexpr int lastRow = ( color == COLOR_RED_VAL ) ? 0 : 7;      // Starting (back) row
+
+    };
+
+
+    ////////// Square Tables //////////
+    // The 32 playable squares are numbered 0-31, row by row ( square = 4*row + col/2 )
+    // Directions are numbered 0-3: Up Left, Up Right, Down Left, Down Right
+    //      Up is towards row 0
+    const int NUM_SQUARES = 32;
+    const int NUM_DIRECTIONS = 4;
+    const int NO_SQUARE = -1;   // Square is off the board
+
+    constexpr int toSquare( int row, int col ) { return 4*row + col/2; }
+    constexpr int toDirection( int rowOffset, int colOffset ) { return 2*( rowOffset > 0 ) + ( colOffset > 0 ); }
+    constexpr int oppositeDirection( int direction ) { return 3 - direction; }
+    constexpr int directionRow( int direction ) { return ( direction >= 2 ) ? 1 : -1; }
+    constexpr int directionCol( int direction ) { return ( direction % 2 ) ? 1 : -1; }
+    constexpr bool onBoard( int row, int col ) { return 0 <= row && row <= 7 && 0 <= col && col <= 7; }
+
+    struct squareTables {
+
+        int row[ NUM_SQUARES ];
+        int col[ NUM_SQUARES ];
+        int neighbour[ NUM_SQUARES ][ NUM_DIRECTIONS ];   // Square reached by a move
+        int landing[ NUM_SQUARES ][ NUM_DIRECTIONS ];     // Square reached by a jump
+        bool promotion[ 2 ][ NUM_SQUARES ];               // If a man of a color is promoted on the square
+
+        // Mask of squares whose pieces may be affected by a move (0) or jump (1) from a square in a direction
+        //      Covers the diagonal of the action and the two diagonals on either side of it
+        unsigned int affected[ NUM_SQUARES ][ NUM_DIRECTIONS ][ 2 ];
+
+    };
+
+    // Adds the squares on the diagonal from (row,col) to (endRow,endCol) inclusive to a mask
+    constexpr unsigned int diagonalMask( int row, int col, int endRow, int endCol, int rowOffset, int colOffset ) {
+
+        unsigned int mask = 0;
+
+        while ( row != endRow+rowOffset && col != endCol+colOffset ) {
+
+            if ( onBoard( row, col ) )
+                mask |= 1u << toSquare( row, col );
+
+            row += rowOffset;
+            col += colOffset;
+
+        }
+
+        return mask;
+
+    }
+
+    constexpr squareTables makeSquareTables() {
+
+        squareTables tables {};
+
+        for ( int square=0; square<NUM_SQUARES; square++ ) {
+
+            int row = square / 4;
+            int col = 2*( square % 4 ) + ( row % 2 == 0 );
+
+            tables.row[ square ] = row;
+            tables.col[ square ] = col;
+            tables.promotion[ COLOR_RED_VAL ][ square ] = ( row == side<COLOR_RED_VAL>::promotionRow );
+            tables.promotion[ COLOR_WHITE_VAL ][ square ] = ( row == side<COLOR_WHITE_VAL>::promotionRow );
+
+            for ( int dir=0; dir<NUM_DIRECTIONS; dir++ ) {
+
+                int rowOffset = directionRow( dir );
+                int colOffset = directionCol( dir );
+
+                if ( onBoard( row+rowOffset, col+colOffset ) )
+                    tables.neighbour[ square ][ dir ] = toSquare( row+rowOffset, col+colOffset );
+                else
+                    tables.neighbour[ square ][ dir ] = NO_SQUARE;
+
+                if ( onBoard( row+2*rowOffset, col+2*colOffset ) )
+                    tables.landing[ square ][ dir ] = toSquare( row+2*rowOffset, col+2*colOffset );
+                else
+                    tables.landing[ square ][ dir ] = NO_SQUARE;
+
+                for ( int len=1; len<=2; len++ ) {
+
+                    int newRow = row + len*rowOffset;
+                    int newCol = col + len*colOffset;
+
+                    // Diagonal of the action, extended by 2 squares at each end
+                    unsigned int mask = diagonalMask( row - 2*rowOffset, col - 2*colOffset,
+                                                      newRow + 2*rowOffset, newCol + 2*colOffset, rowOffset, colOffset );
+
+                    // Parallel diagonals, 1 and 2 squares away on either side
+                    for ( int perp=-2; perp<=2; perp++ ) {
+
+                        if ( perp != 0 )
+                            mask |= diagonalMask( row + perp*rowOffset, col - perp*colOffset,
+                                                  newRow + perp*rowOffset, newCol - perp*colOffset, rowOffset, colOffset );
+
+                    }
+
+                    tables.affected[ square ][ dir ][ len-1 ] = mask;
+
+                }
+
+            }
+
+        }
+
+        return tables;
+
+    }
+
+    constexpr squareTables SQUARES = makeSquareTables();
+
+
+    ////////// Square Masks //////////
+    // A set of squares is stored as a 32-bit mask, where bit n represents square n
+    constexpr unsigned int squareBit( int square ) { return 1u << square; }
+    inline int countSquares( unsigned int mask ) { return __builtin_popcount( mask ); }
+    inline int firstSquare( unsigned int mask ) { return __builtin_ctz( mask ); }   // mask must not be 0
+
+
+    ////////// Mirror Images //////////
+    // Swapping the colors and rotating the board by 180 degrees gives an equivalent position
+    //      with the other player to move
+    // Rotating the board maps square n to square 31-n
+    constexpr int mirrorSquare( int square ) { return NUM_SQUARES - 1 - square; }
+
+    inline unsigned int mirrorMask( unsigned int mask ) {
+
+        unsigned int mirrored = 0;
+
+        for ( ; mask; mask &= mask - 1 )
+            mirrored |= squareBit( mirrorSquare( firstSquare( mask ) ) );
+
+        return mirrored;
+
+    }
+
+
+    ////////// Zobrist Keys //////////
+    // A position is hashed by XORing a random key for each piece (by color, type and square)
+    //      and a key for Red to move
+    struct zobristTables {
+
+        unsigned long long piece[ 2 ][ 2 ][ NUM_SQUARES ];
+        unsigned long long redTurn;
+
+    };
+
+    // SplitMix64 generator, used to fill the tables at compile time
+    constexpr unsigned long long splitMix( unsigned long long &state ) {
+
+        unsigned long long z = ( state += 0x9E3779B97F4A7C15ULL );
+        z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+        z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+        return z ^ ( z >> 31 );
+
+    }
+
+    constexpr zobristTables makeZobristTables() {
+
+        zobristTables tables {};
+        unsigned long long state = 0;
+
+        for ( int color=0; color<2; color++ )
+            for ( int type=0; type<2; type++ )
+                for ( int square=0; square<NUM_SQUARES; square++ )
+                    tables.piece[ color ][ type ][ square ] = splitMix( state );
+
+        tables.redTurn = splitMix( state );
+
+        return tables;
+
+    }
+
+    constexpr zobristTables ZOBRIST = makeZobristTables();
+
+
+    ////////// Actions //////////
+    // An action moves a piece from one square to another, packed into 16 bits
+    //      Bits 0-4: Start square
+    //      Bits 5-9: Destination square
+    //      Bit 10: Set if the action is a jump
+    typedef unsigned short action;
+
+    constexpr action makeAction( int start, int destination, bool jump ) { return action( start | ( destination << 5 ) | ( jump << 10 ) ); }
+    constexpr int actionStart( action curAction ) { return curAction & 31; }
+    constexpr int actionDestination( action curAction ) { return ( curAction >> 5 ) & 31; }
+    constexpr bool actionJump( action curAction ) { return ( curAction >> 10 ) & 1; }
+
+    // Square of the piece captured by a jump
+    constexpr int actionCaptured( action curAction ) {
+
+        return toSquare( ( SQUARES.row[ actionStart( curAction ) ] + SQUARES.row[ actionDestination( curAction ) ] )/2,
+                         ( SQUARES.col[ actionStart( curAction ) ] + SQUARES.col[ actionDestination( curAction ) ] )/2 );
+
+    }
+
+    // Direction of an action
+    constexpr int actionDirection( action curAction ) {
+
+        return toDirection( SQUARES.row[ actionDestination( curAction ) ] - SQUARES.row[ actionStart( curAction ) ],
+                            SQUARES.col[ actionDestination( curAction ) ] - SQUARES.col[ actionStart( curAction ) ] );
+
+    }
+
+    // Action on the mirror image of the board
+    constexpr action mirrorAction( action curAction ) {
+
+        return makeAction( mirrorSquare( actionStart( curAction ) ), mirrorSquare( actionDestination( curAction ) ), actionJump( curAction ) );
+
+    }
+
+    const int MAX_PIECE_ACTIONS = 4;    // Moves or jumps available to a single piece
+    const int MAX_TURN_ACTIONS = 18;    // Jumps in a single turn (only pieces away from the edges can be captured)
+    const int MAX_LINE_ACTIONS = 128;   // Actions along a line of the minimax search
+    const int MAX_TURNS = 128;          // Turns available to a player
+    const int MAX_SIDE_ACTIONS = 48;    // Moves or jumps available to all pieces of a player
+
+
+    // List with a fixed capacity, stored inline so it can live on the stack
+    template< typename T, int capacity >
+    class fixedList {
+
+    public:
+
+        void push_back( const T &item ) { items[ count++ ] = item; }
+        void pop_back() { count--; }
+        void clear() { count = 0; }
+
+        // Removes all items equal to item, keeping the order of the remaining items
+        void remove( const T &item ) { count = int( std::remove( items, items+count, item ) - items ); }
+        void erase( T *iter ) { std::copy( iter+1, items+count, iter ); count--; }
+
+        int size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        T &operator[]( int i ) { return items[i]; }
+        const T &operator[]( int i ) const { return items[i]; }
+        T &front() { return items[0]; }
+        T &back() { return items[ count-1 ]; }
+        const T &front() const { return items[0]; }
+        const T &back() const { return items[ count-1 ]; }
+
+        bool operator==( const fixedList &other ) const { return count == other.count && std::equal( items, items+count, other.items ); }
+
+        T *begin() { return items; }
+        T *end() { return items + count; }
+        const T *begin() const { return items; }
+        const T *end() const { return items + count; }
+
+    private:
+
+        T items[ capacity ];
+        int count = 0;
+
+    };
+
+    typedef fixedList< action, MAX_PIECE_ACTIONS > pieceActions;   // Moves or jumps of a single piece
+    typedef fixedList< action, MAX_LINE_ACTIONS > actionLine;      // Actions leading to a position
+
+    // Sequence of actions taken by a player in a single turn
+    struct turn {
+
+        fixedList< action, MAX_TURN_ACTIONS > actions;
+        unsigned int captured = 0;  // Mask of squares captured along the path of a multi-jump
+
+    };
+
+    typedef fixedList< turn, MAX_TURNS > turnList;
+
 };
 
+using checkersVals::action;
+using checkersVals::pieceActions;
+using checkersVals::actionLine;
+using checkersVals::turn;
+using checkersVals::turnList;
+
+class mctsTree;
+class taskPool;
+class openingBook;
+class transpositionTable;
+class searchTrace;
+class evalCache;
+struct engineContext;
+struct proofSearch;
+struct solveResult;
+struct principalLine;
+
 
 class board {
 
@@ -59,6 +424,70 @@ public:
     void specialBoard(); // For testing boards
     void playGame();
 
+    // Plays a headless match between engines A and B across all cores, with openings played from both sides
+    // Each engine is given as an engine number and a time per move in seconds, followed by the number of games
+    // Stops early once a sequential probability ratio test of elo0 against elo1 (for A) is conclusive
+    static void playMatch( int, double, int, double, int, float, float );
+
+    // Builds an opening book from the positions reachable from the starting board within a number of turns
+    // Each position is searched by minimax for the given number of seconds, across all cores
+    static void buildBook( int, double, const string & );
+
+    // Opens the opening book probed before each search
+    // If the file is missing or invalid, returns false and the engines search every position
+    static bool loadBook( const string & );
+
+    // Serves analysis requests on a localhost port until the process is killed
+    // The transposition table and opening book stay warm between requests
+    static void runDaemon( int );
+
+    // Maps the transposition table to a file, so it is kept across runs
+    // If the file is stale or invalid, the table starts empty; if it cannot be mapped, the table stays in memory
+    static bool mapTable( const string & );
+
+    // Loads or saves a snapshot of the deep entries of the transposition table
+    // Stale or invalid snapshots are ignored
+    static bool loadTable( const string & );
+    static bool saveTable( const string & );
+
+    // Loads a snapshot of the table, and saves the table back to the same file after each game
+    // If no snapshot is used, games save nothing
+    static bool useSnapshot( const string & );
+
+    // Saves a snapshot of the table to the file given to useSnapshot, or to TABLE_SNAPSHOT_FILE if none was given
+    static bool saveSnapshot();
+
+    // Records the nodes visited by minimax to a binary trace file, for offline analysis with traceView
+    // If the file cannot be opened, returns false
+    static bool startTrace( const string & );
+
+    // In deterministic mode, the heuristic adds no random noise and ties between actions are not broken randomly,
+    //      so searches are repeatable and cached scores match freshly computed ones
+    static void setDeterministic( bool );
+
+    // With table mirroring, a position and its mirror image share transposition table entries
+    // The heuristic is not exactly antisymmetric, so a mirrored entry may differ slightly from a fresh search; off by default
+    //      The opening book always shares entries between mirror images
+    static void setMirrorTable( bool );
+
+    // Answers a single analysis request line
+    // Returns the response line, without a newline
+    static string analyse( const string & );
+
+    // Returns the threads shared by searches, starting them on first use
+    // The first call sets the number of threads, 0 for one less than the number of cores
+    static taskPool &workerPool( int = 0 );
+
+    // Proves the result of a board file with the given player to move, searching up to a number of positions
+    static void solveFile( const string &, bool, long );
+
+    // Prints the best lines of a board file with the given player to move, given the time in seconds and the number of lines
+    static void multiPVFile( const string &, bool, double, int );
+
+    // Proves the result of the board for the player to move by depth-first proof-number search
+    // Gives up once the number of positions searched or the solver's table reaches its budget
+    solveResult solve( long );
+
 
     class piece {
 
@@ -75,10 +504,11 @@ public:
 
         // Checks if a piece should be promoted
         // If successful, returns true; else, returns false
+        template< bool color >
         bool checkPromotion(board &);
 
         // Returns a pointer to the list of actions that can be taken by the piece
-        list< tuple<int,int> >* returnActions();
+        pieceActions* returnActions();
 
         void insertMove( board & );
         void removeMove( board & );
@@ -96,10 +526,10 @@ public:
         bool validMove = false;
         bool validJump = false;
 
-        list< tuple<int,int> > moves; // Represents possible squares to move to
-        list< tuple<int,int> > jumps; // Represents possible squares to jump to
+        pieceActions moves; // Represents possible moves
+        pieceActions jumps; // Represents possible jumps
 
-        tuple<int,int> loc; // Represents the location of the piece in the board
+        int loc; // Represents the square of the piece in the board
 
     };
 
@@ -114,31 +544,42 @@ private:
 
     float score;            // Score determined by the heuristic
     int turnCount = 1;      // Current turn
-    int computerTime;       // Amount of time in seconds computer has to calculate move
+    double computerTime;    // Amount of time in seconds computer has to calculate move
     bool redTurn = false;   // If true, red has current move; else, white has current move
     bool AIvsAI = false;    // If true, computer plays itself; else, computer plays against player
     int maxDepth;           // Maximum depth set by iterative deepening
+    int extensionsLeft = EXTENSION_BUDGET;  // Forced replies the current line can still be extended by
+    int engine[2] = { checkersVals::ENGINE_MINIMAX, checkersVals::ENGINE_MINIMAX };    // Engine used by the computer for each color
+    int numThreads = 0;     // Threads used by Monte Carlo Tree Search, 0 to use all cores
+    double bankedTime = 0;  // Time saved by book turns, spent on later searches
+
+    static openingBook book;            // Opening book shared by all boards
+    static transpositionTable table;    // Transposition table shared by all searches
+    static searchTrace trace;           // Trace of the nodes visited by minimax, when enabled
+    static evalCache evals;             // Heuristic scores shared by all searches
+    static bool deterministic;          // If true, scores and searches have no randomness
+    static string snapshotFile;         // Snapshot of the table saved after each game, empty if none is used
+    static bool mirrorTable;            // If true, the table is probed and stored by canonical key
+
+    // Table and cache used by searches from this board, passed on to the boards searched below it
+    //      The shared ones, unless a match gives each engine its own
+    transpositionTable *searchTable = &table;
+    evalCache *searchEvals = &evals;
 
     // Keeps track of time taken during minimax search
     std::chrono::time_point<std::chrono::system_clock> startTime, endTime;
     std::chrono::duration<double> elapsed_seconds;
 
     // Stores a list of moves to get to current position
-    list< tuple< tuple<int,int>, tuple<int,int> > > moves;
-
-    // Stores a shared_ptr to all of the pieces
-    unordered_set< shared_ptr<piece> > redPieces;
-    unordered_set< shared_ptr<piece> > whitePieces;
+    actionLine moves;
 
-    // Stores a shared_ptr to all of pieces that are available to move/jump
-    unordered_set< shared_ptr<piece> > redMoves;
-    unordered_set< shared_ptr<piece> > redJumps;
-    unordered_set< shared_ptr<piece> > whiteMoves;
-    unordered_set< shared_ptr<piece> > whiteJumps;
-    unordered_set< shared_ptr<piece> > multiJumps;
+    // Masks of the squares holding pieces, indexed by color
+    unsigned int pieceMask[2] = { 0, 0 };
 
-    // Stores a vector of vectors representing a sequence of available actions during the current turn
-    vector< vector< tuple< tuple<int,int>, tuple<int,int> > > > vecOfActions;
+    // Masks of the squares holding pieces that are available to move/jump, indexed by color
+    unsigned int moveMask[2] = { 0, 0 };
+    unsigned int jumpMask[2] = { 0, 0 };
+    unsigned int multiJumpMask = 0;     // Piece that must continue a multi-jump
 
     ////////// Count of pieces //////////
 
@@ -155,47 +596,151 @@ private:
 
     ////////// Private Functions //////////
 
-    void computerMove();
-    void playerMove();
+    // Loads piece counts, masks and actions for the pieces on the board
+    void loadPieces();
+
+    // Plays a turn and returns it
+    turn computerMove( mctsTree & );
+    turn playerMove();
     void endTurn();     // Series of actions to be taken at the end of a turn
 
-    // Updates vecOfActions, representing available actions for the current turn, including multi-jumps
-    void getCurTurnActions( board &, vector< tuple< tuple<int,int>, tuple<int,int> > > );
+    // Performs the actions of a turn and passes the move to the other player, without any output
+    void applyTurn( const turn & );
+
+    // Searches for the best actions with the engine set for the current color
+    actionLine searchMoves( mctsTree &, int &, float & );
+
+    // Searches for the best turns by iterative deepening, each with an exact score and its line (multi-PV)
+    // Returns up to the given number of lines, from best to worst for the player to move
+    vector< principalLine > searchLines( int );
+
+    // Returns the Zobrist key of the board, or of its mirror image
+    unsigned long long hashKey();
+    unsigned long long mirrorKey();
+
+    // Returns the canonical key of the board, the smaller of its Zobrist key and the key of its mirror image
+    // Sets mirrored if the key is the key of the mirror image
+    unsigned long long canonicalKey( bool & );
+
+    // Returns the key of the board in the evaluation cache
+    // The heuristic also depends on the turn count, so it is mixed into the Zobrist key
+    unsigned long long evalKey();
+
+    // Finds the book turn for the board among the available turns
+    // If the board is not in the book, returns false
+    bool probeBook( turnList &, turn & );
+
+    ////////// Engine Matches //////////
+
+    // Plays random turns from the current board, using the given seed
+    void randomOpening( unsigned int );
+
+    // Plays a game from the current board without any output, with the search state and time per move of each color's engine
+    // Returns the result for Red: 2 for a win, 1 for a draw, 0 for a loss
+    int playHeadless( engineContext *, const double * );
+
+    // Appends the available turns for the current player to a list, including multi-jumps
+    void getCurTurnActions( board &, turn, turnList & );
 
     // Alpha-beta pruning with iterative deepening
     // Returns a score and a list of moves to reach the state with that score
-    tuple< float, list< tuple< tuple<int,int>, tuple<int,int> > > > minimax( board &, int, bool, float, float );
+    // Dispatches to the instantiation for the side to move
+    tuple< float, actionLine > minimax( board &, int, bool, float, float );
+    template< bool color >
+    tuple< float, actionLine > minimax( board &, int, float, float );
 
     // Returns the score at a leaf node
-    tuple< float, list< tuple< tuple<int,int>, tuple<int,int> > > > returnFromLeaf( board &, int );
+    tuple< float, actionLine > returnFromLeaf( board &, int );
+
+    // Searches the board, with a number of turns left for the win, until its proof number reaches the first limit
+    //      or its disproof number reaches the second
+    // Stores the numbers found in the solver's table
+    void proveNode( proofSearch &, int, unsigned int, unsigned int );
+
+    // Plays each available turn on a copy of the board
+    void expandNode( vector< board > & );
+
+    // Counts the positions in the proof (or disproof) tree below the board, each position once
+    long proofTreeSize( proofSearch &, bool );
+
+    // Records a node of the search to the trace
+    // Given the alpha-beta window of the node, the score returned and the trace flags
+    void traceNode( float, float, float, int );
+
+    // Stores the result of a search in the transposition table
+    // Given the canonical key and whether it is the key of the mirror image, the best score and action, depth, remaining depth and the starting alpha-beta window
+    void storeResult( unsigned long long, bool, float, action, int, int, float, float );
 
     // Isolates a board for iterative deepening
     // Used in minimax
-    void isolateBoard( tuple<int,int>, tuple<int,int> );
+    void isolateBoard( action );
+
+    // Returns the board entry for a square number
+    shared_ptr< piece > &squareAt( int square ) { return gameboard[ checkersVals::SQUARES.row[ square ] ][ checkersVals::SQUARES.col[ square ] ]; }
+
+    // Returns a mask of the squares of pieces affected by a move
+    unsigned int affectedPieces( action );
 
-    // Returns a list of pointers to pieces affected by a move
-    list< shared_ptr< piece > > affectedPieces( tuple<int,int>, tuple<int,int> );
+    // Returns a mask of the squares of pieces that can be moved
+    unsigned int returnPieces();
+    template< bool color >
+    unsigned int returnPieces();
 
-    // Returns a pointer to the set of pieces that can be moved
-    unordered_set< shared_ptr<piece> >* returnPieces();
+    // Checks if the player of a color has no choice of reply (a capture or a single move)
+    template< bool color >
+    bool forcedReply();
 
     // Performs a specified move
     // If another jump is possible, returns true; otherwise, returns false
-    bool moveResult( tuple<int,int>, tuple<int,int> );
+    bool moveResult( action );
+    template< bool color >
+    bool moveResult( action );
 
     // Checks moves of a specific piece
     void checkMoves( shared_ptr<piece> & );
+    template< bool color, int type >
+    void checkMoves( shared_ptr<piece> & );
 
     // Checks moves of pieces affected by curPiece's move
-    void checkDiagMoves( shared_ptr<piece> &, tuple<int,int>, bool );
+    template< bool color >
+    void checkDiagMoves( shared_ptr<piece> &, action );
 
     // Updates the current score of the board
     void heuristic();
+    template< bool color >
+    void heuristic();
+
+    // Adds the positional score of one color's pieces
+    template< bool color >
+    void sideScore( float &, int &, float &, float &, int & );
 
     // Returns a score corresponding to how close a king is to an enemy piece
+    template< bool color >
     float addKingDist( shared_ptr<piece> & );
+    template< bool color >
     int kingDistance( shared_ptr<piece> & );
 
+    ////////// Monte Carlo Tree Search //////////
+
+    // Searches from the current board across all cores until the time limit
+    // Returns the actions of the most visited turn
+    actionLine mctsSearch( mctsTree &, int & );
+
+    // Runs iterations of the search until stop is set
+    void mctsWorker( mctsTree &, std::atomic<bool> &, std::atomic<int> & );
+
+    // Selects a path down the tree from the current board, expands its leaf and backs up a rollout result
+    void mctsIteration( mctsTree &, vector< std::pair<int,bool> > & );
+
+    // Creates the children of a node for the turns available on the current board
+    void mctsExpand( mctsTree &, int );
+
+    // Returns the child of a node with the highest UCT value
+    int mctsSelect( mctsTree &, int );
+
+    // Plays the current board out and returns the result for Red: 2 for a win, 1 for a draw, 0 for a loss
+    int mctsRollout( int );
+
     // Checks if the game is at a terminal state
     bool terminalState( float );
     bool currentTerminalState( float );
@@ -211,6 +756,13 @@ private:
     // Loads a board from a file
     void loadBoard();
 
+    // Reads the squares of a board, in the order used by board files
+    // If there are more than 32 squares or an invalid piece, returns false
+    bool readBoard( std::istream & );
+
+    // Loads a board file given on the command line, with the given player to move
+    void loadBoardFile( const string &, bool );
+
     ////////// Display Functions //////////
 
     void printVictory( bool, bool );
@@ -228,6 +780,391 @@ private:
     void printHelp();       // Prints a list of commands
     void printError();      // Prints an error message
     void printMoveError();  // Prints a move error message
+    void printEngine( bool );   // Prints the engine used by a color
+
+};
+
+
+// View of a file mapped into memory
+class mappedFile {
+
+public:
+
+    mappedFile() {}
+    ~mappedFile();
+
+    mappedFile( const mappedFile & ) = delete;
+    mappedFile &operator=( const mappedFile & ) = delete;
+
+    // Maps a file into memory for reading
+    // If the file cannot be opened or is empty, returns false
+    bool open( const string & );
+
+    // Maps a file into memory for reading and writing, creating it or resizing it to the given size
+    // Changes are written back to the file
+    // If the file cannot be created or mapped, returns false
+    bool create( const string &, size_t );
+
+    // Writes changes back to the file
+    void flush();
+    void close();
+
+    const char *data() const { return view; }
+    char *writableData() { return view; }
+    size_t size() const { return length; }
+
+private:
+
+    char *view = nullptr;
+    size_t length = 0;
+
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mapHandle = nullptr;
+#endif
+
+};
+
+
+// Book entry for a position, in the orientation given by its canonical key
+//      The turn is identified by its start square, final square and captured pieces
+struct bookEntry {
+
+    unsigned long long key;     // Smaller of the Zobrist keys of the position and its mirror image
+    unsigned int captured;      // Mask of squares captured by the turn
+    float score;                // Minimax score for the player to move
+    action move;                // Start square and final square of the turn
+
+};
+
+// Header at the start of a book file, followed by the entries sorted by key
+struct bookHeader {
+
+    char magic[8];
+    unsigned int version;
+    unsigned int numEntries;
+
+};
+
+
+// Opening book read from a memory-mapped file
+class openingBook {
+
+public:
+
+    // Maps a book file into memory
+    // If the file is missing or has the wrong format, returns false and the book stays empty
+    bool open( const string & );
+
+    // Returns the entry for a key, or nullptr if the key is not in the book
+    const bookEntry *find( unsigned long long ) const;
+
+    bool empty() const { return numEntries == 0; }
+
+private:
+
+    mappedFile file;
+    const bookEntry *entries = nullptr;
+    int numEntries = 0;
+
+};
+
+
+// Search result stored in the transposition table
+struct tableEntry {
+
+    float score;
+    action move;    // First action of the best line from the position, 0 if there is none
+    int depth;      // Depth searched below the position
+    int bound;      // BOUND_EXACT, BOUND_LOWER or BOUND_UPPER
+
+};
+
+
+// Header at the start of a table file or snapshot file
+//      A table file is followed by the slots of the table, and a snapshot file by pairs of keys and packed entries
+struct tableHeader {
+
+    char magic[8];
+    unsigned int version;
+    unsigned int numEntries;
+    unsigned long long checksum;    // Checksum of everything after the header, unused by table files, whose slots are checked one by one
+
+};
+
+
+// Transposition table shared by all searches, indexed by Zobrist key
+// Each slot holds the key XORed with the packed entry and the packed entry itself,
+//      so threads can probe and store without locks; a slot torn by two stores fails the key check
+class transpositionTable {
+
+public:
+
+    static const int BOUND_EXACT = 0;   // Score is exact
+    static const int BOUND_LOWER = 1;   // Score is a lower bound (the search failed high)
+    static const int BOUND_UPPER = 2;   // Score is an upper bound (the search failed low)
+
+    transpositionTable();
+    ~transpositionTable();
+
+    // Finds the entry for a key
+    // If the key is not in the table, returns false
+    bool probe( unsigned long long, tableEntry & ) const;
+
+    // Stores an entry, replacing entries from older searches or shallower searches of other positions
+    void store( unsigned long long, const tableEntry & );
+
+    // Starts a new search, so entries from older searches are replaced first
+    void newSearch();
+
+    // Removes all entries
+    void clear();
+
+    // Moves the table into a memory-mapped file, keeping the entries of the file that pass their checks if its header is current
+    // If the file cannot be mapped, returns false and the table stays in memory
+    bool mapFile( const string & );
+
+    // Flushes a mapped table to its file
+    void sync();
+
+    // Adds the entries of a snapshot file
+    // If the file is missing, stale or corrupt, returns false
+    bool loadSnapshot( const string & );
+
+    // Writes the entries searched to at least a depth to a snapshot file
+    // If the file cannot be written, returns false
+    bool saveSnapshot( const string &, int );
+
+private:
+
+    struct slot {
+
+        std::atomic<unsigned long long> check;  // Key XORed with data
+        std::atomic<unsigned long long> data;   // Packed entry and the search that stored it
+
+    };
+
+    slot *slots;                        // Points into memory, or into file once the table is mapped
+    std::unique_ptr< slot[] > memory;
+    mappedFile file;
+    std::atomic<unsigned int> generation;
+
+};
+
+
+// Cache of heuristic scores shared by all searches, indexed by Zobrist key
+// Slots are checked by XORing the key with the data, like the transposition table, so no locks are needed
+class evalCache {
+
+public:
+
+    evalCache();
+
+    // Finds the score for a key
+    // If the key is not in the cache, returns false
+    bool probe( unsigned long long, float & ) const;
+
+    // Stores the score for a key, replacing the current entry of its slot
+    void store( unsigned long long, float );
+
+    // Removes all entries
+    void clear();
+
+private:
+
+    struct slot {
+
+        std::atomic<unsigned long long> check;  // Key XORed with data
+        std::atomic<unsigned long long> data;   // Score, with bit 32 set so an entry is never 0
+
+    };
+
+    std::unique_ptr< slot[] > slots;
+
+};
+
+
+// Node visited by minimax, recorded when the search returns from it
+//      Records of a thread are in post-order, so a node follows all of its children
+struct traceRecord {
+
+    float alpha;            // Alpha-beta window the node was searched with
+    float beta;
+    float score;            // Score returned, TIME_LIMIT_EXCEEDED if the search ran out of time
+    action move;            // Last action leading to the node, 0 at the root
+    unsigned char ply;      // Actions from the root
+    unsigned char flags;    // searchTrace::FLAG_*
+
+};
+
+// Header at the start of a trace file, followed by chunks of records
+struct traceHeader {
+
+    char magic[8];
+    unsigned int version;
+    unsigned int recordSize;
+
+};
+
+// Header of a chunk of records written by a single thread
+struct traceChunk {
+
+    unsigned int thread;
+    unsigned int numRecords;
+
+};
+
+
+// Binary trace of the nodes visited by minimax
+// Each thread buffers its records and writes them as a chunk when the buffer is full,
+//      after each search and when the thread exits
+class searchTrace {
+
+public:
+
+    static const int FLAG_LEAF = 1;             // Scored by the heuristic
+    static const int FLAG_CUTOFF = 2;           // Remaining actions were pruned
+    static const int FLAG_TABLE_HIT = 4;        // Found in the transposition table
+    static const int FLAG_TABLE_CUTOFF = 8;     // Score was taken from the transposition table
+    static const int FLAG_TIMEOUT = 16;         // Search ran out of time below the node
+
+    ~searchTrace();
+
+    // Opens the trace file and enables tracing
+    // If the file cannot be opened, returns false
+    bool start( const string & );
+
+    bool enabled() const { return active; }
+
+    // Adds a record to the buffer of the current thread
+    void record( const traceRecord & );
+
+    // Writes the buffer of the current thread to the file
+    void flush();
+
+    // Writes a chunk of records from a thread to the file
+    void write( unsigned int, const traceRecord *, int );
+
+private:
+
+    bool active = false;
+    std::unique_ptr< std::ofstream > output;
+    std::mutex outputLock;
+
+};
+
+
+// Result of a proof-number search
+struct solveResult {
+
+    int result = checkersVals::SOLVE_UNKNOWN;   // SOLVE_WIN, SOLVE_LOSS or SOLVE_DRAW for the player to move, or SOLVE_UNKNOWN
+    turn bestTurn;      // Turn that forces the win, if the result is SOLVE_WIN
+    long proofSize = 0; // Positions in the trees proving the result
+    long nodes = 0;     // Positions searched
+
+};
+
+
+// Line found by a multi-PV search
+struct principalLine {
+
+    turn rootTurn;      // Turn the line starts with
+    float score;        // Exact minimax score (positive for Red)
+    actionLine moves;   // Actions along the line, starting with the actions of rootTurn
+
+};
+
+
+// Fixed set of threads that run queued tasks in order, kept for the life of the process
+class taskPool {
+
+public:
+
+    taskPool( int );
+    ~taskPool();
+
+    // Queues a task to be run by the next free thread
+    void submit( std::function< void() > );
+
+    // Runs a function on up to a number of threads, each given its own index, and waits for them
+    //      The calling thread runs index 0, and free threads of the pool run the others
+    //      Indices not yet started when index 0 finishes are skipped
+    void parallel( int, const std::function< void( int ) > & );
+
+    int size() const { return int( threads.size() ); }
+
+private:
+
+    // Runs queued tasks until the pool is destroyed
+    void workerLoop();
+
+    vector< std::thread > threads;
+    std::deque< std::function< void() > > tasks;
+    std::mutex lock;
+    std::condition_variable available;
+    bool stopping = false;
+
+};
+
+
+// Node of a Monte Carlo search tree
+struct mctsNode {
+
+    turn move;                      // Turn leading to the node
+    int firstChild;                 // Children are stored contiguously in the arena
+    int numChildren;
+    std::atomic<int> state;         // NODE_LEAF, NODE_EXPANDING or NODE_EXPANDED
+    std::atomic<int> visits;        // Includes virtual losses of threads currently searching below the node
+    std::atomic<int> points;        // Results for the player who made move: 2 for a win, 1 for a draw
+
+};
+
+
+// Arena of nodes for a Monte Carlo search tree
+// Kept between turns so the subtree below the turns played can be reused
+class mctsTree {
+
+public:
+
+    static const int NODE_LEAF = 0;
+    static const int NODE_EXPANDING = 1;    // Being expanded by a thread, or the arena is full
+    static const int NODE_EXPANDED = 2;
+
+    mctsTree();
+
+    // Allocates the arena on first use and clears it once more than half of it is used
+    void prepare();
+
+    // Clears the tree, leaving an unexpanded root
+    void reset();
+
+    // Moves the root to the child reached by a turn
+    // If the turn is not in the tree, clears the tree
+    void advance( const turn & );
+
+    // Reserves a block of nodes and returns the index of the first
+    // If the arena is full, returns -1
+    int allocate( int );
+
+    mctsNode &operator[]( int index ) { return nodes[ index ]; }
+
+    int root = 0;   // Index of the node for the current board
+
+private:
+
+    std::unique_ptr< mctsNode[] > nodes;
+    std::atomic<int> next;  // Index of the next free node
+
+};
+
+
+// Search state kept by an engine between its turns in a match
+//      Each engine in each game has its own, so no entries or table generations are shared with the other engine or other games
+struct engineContext {
+
+    mctsTree tree;
+    transpositionTable table;
+    evalCache evals;
 
 };
 
@@ -0,0 +1,271 @@
+#include "checkers.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <unordered_set>
+
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::thread;
+using std::atomic;
+using std::mutex;
+using std::lock_guard;
+using std::unordered_set;
+using std::sort;
+using std::max;
+
+using namespace checkersVals;
+
+openingBook board::book;
+
+
+///////////////////////////////////// Opening Book /////////////////////////////////////
+
+// Maps a book file into memory
+// If the file is missing or has the wrong format, returns false and the book stays empty
+bool openingBook::open( const string &fileName ) {
+
+    entries = nullptr;
+    numEntries = 0;
+
+    if ( !file.open( fileName ) )
+        return false;
+
+    const bookHeader *header = reinterpret_cast< const bookHeader * >( file.data() );
+
+    // Rejects files from other versions or with a size that does not match the header
+    if ( file.size() < sizeof( bookHeader )
+         || strncmp( header->magic, BOOK_MAGIC, sizeof( header->magic ) ) != 0
+         || header->version != BOOK_VERSION
+         || file.size() != sizeof( bookHeader ) + size_t( header->numEntries ) * sizeof( bookEntry ) ) {
+
+        file.close();
+        return false;
+
+    }
+
+    entries = reinterpret_cast< const bookEntry * >( file.data() + sizeof( bookHeader ) );
+    numEntries = header->numEntries;
+
+    return true;
+
+}
+
+
+// Returns the entry for a key, or nullptr if the key is not in the book
+// Entries are sorted by key, so the book is binary searched
+const bookEntry *openingBook::find( unsigned long long key ) const {
+
+    const bookEntry *entry = std::lower_bound( entries, entries + numEntries, key,
+                                               []( const bookEntry &curEntry, unsigned long long curKey ) { return curEntry.key < curKey; } );
+
+    if ( entry == entries + numEntries || entry->key != key )
+        return nullptr;
+
+    return entry;
+
+}
+
+
+// Opens the opening book probed before each search
+// If the file is missing or invalid, returns false
+bool board::loadBook( const string &fileName ) {
+
+    return book.open( fileName );
+
+}
+
+
+// Finds the book turn for the board among the available turns
+// If the board is not in the book, returns false
+bool board::probeBook( turnList &turns, turn &bookTurn ) {
+
+    if ( book.empty() )
+        return false;
+
+    // Looks up the canonical key
+    // If the mirror image was stored, the turn is mirrored back
+    bool mirrored;
+    const bookEntry *entry = book.find( canonicalKey( mirrored ) );
+
+    if ( entry == nullptr )
+        return false;
+
+    action move = mirrored ? mirrorAction( entry->move ) : entry->move;
+    unsigned int captured = mirrored ? mirrorMask( entry->captured ) : entry->captured;
+    int start = actionStart( move );
+    int destination = actionDestination( move );
+
+    // Also guards against a different position with the same key
+    for ( turn &iter : turns ) {
+
+        if ( actionStart( iter.actions.front() ) == start && actionDestination( iter.actions.back() ) == destination && iter.captured == captured ) {
+
+            bookTurn = iter;
+            return true;
+
+        }
+
+    }
+
+    return false;
+
+}
+
+
+// Builds an opening book from the positions reachable from the starting board within a number of turns
+// Each position is searched by minimax for the given number of seconds, with positions spread across all cores
+void board::buildBook( int numTurns, double seconds, const string &fileName ) {
+
+    if ( numTurns <= 0 || seconds <= REMAINING_TIME_LIMIT ) {
+
+        std::cerr << "The number of turns and the time must be positive.";
+        exit( EXIT_FAILURE );
+
+    }
+
+    ////////// Expansion //////////
+    // Expands the early game tree breadth first
+    // A position and its mirror image share a canonical key and are only kept once
+    // Positions with a single turn are expanded but not stored, since they are never searched
+    vector< board > positions, level, nextLevel;
+    unordered_set< unsigned long long > seen;
+    turnList turns;
+
+    bool mirrored;
+    board start;
+    start.loadPieces();
+    seen.insert( start.canonicalKey( mirrored ) );
+    level.push_back( start );
+
+    for ( int depth=0; depth<numTurns; depth++ ) {
+
+        nextLevel.clear();
+
+        for ( board &iter : level ) {
+
+            turns.clear();
+            iter.getCurTurnActions( iter, turn(), turns );
+
+            if ( turns.size() > 1 )
+                positions.push_back( iter );
+
+            if ( depth == numTurns-1 )
+                continue;
+
+            // Pieces are copied as they are affected by the turn, so iter is not changed
+            // Children are only kept the first time their position is reached, so each level holds distinct positions
+            for ( turn &curTurn : turns ) {
+
+                board tempBoard = iter;
+                tempBoard.applyTurn( curTurn );
+
+                if ( seen.insert( tempBoard.canonicalKey( mirrored ) ).second )
+                    nextLevel.push_back( tempBoard );
+
+            }
+
+        }
+
+        level.swap( nextLevel );
+
+    }
+
+    cout << "Positions: " << positions.size() << "\n" << endl;
+
+    ////////// Search //////////
+    vector< bookEntry > entries( positions.size() );
+    atomic<int> nextPosition( 0 );
+    mutex outputLock;
+    int numSearched = 0;
+
+    // Each thread searches positions until all positions are searched
+    auto searchPositions = [&]() {
+
+        mctsTree tree;
+        turnList positionTurns;
+        actionLine line;
+        int index, iterations;
+        float score;
+
+        while ( ( index = nextPosition++ ) < int( positions.size() ) ) {
+
+            board &position = positions[ index ];
+
+            position.numThreads = 1;
+            position.engine[ COLOR_RED_VAL ] = ENGINE_MINIMAX;
+            position.engine[ COLOR_WHITE_VAL ] = ENGINE_MINIMAX;
+            position.computerTime = seconds;
+
+            line = position.searchMoves( tree, iterations, score );
+
+            // Finds the turn the best line starts with
+            positionTurns.clear();
+            position.getCurTurnActions( position, turn(), positionTurns );
+
+            turn *bestTurn = &positionTurns.front();
+
+            for ( turn &iter : positionTurns ) {
+
+                if ( iter.actions.size() <= line.size() && std::equal( iter.actions.begin(), iter.actions.end(), line.begin() ) ) {
+
+                    bestTurn = &iter;
+                    break;
+
+                }
+
+            }
+
+            // Stores the turn in the orientation of the canonical key
+            bool mirrored;
+            action move = makeAction( actionStart( bestTurn->actions.front() ), actionDestination( bestTurn->actions.back() ),
+                                      actionJump( bestTurn->actions.front() ) );
+
+            bookEntry entry {};
+            entry.key = position.canonicalKey( mirrored );
+            entry.captured = mirrored ? mirrorMask( bestTurn->captured ) : bestTurn->captured;
+            entry.score = position.redTurn ? score : -score;
+            entry.move = mirrored ? mirrorAction( move ) : move;
+            entries[ index ] = entry;
+
+            lock_guard< mutex > lock( outputLock );
+            cout << "Searched: " << ++numSearched << " / " << positions.size() << endl;
+
+        }
+
+    };
+
+    int threadCount = max( 1, int( thread::hardware_concurrency() ) );
+    vector< thread > workers;
+
+    for ( int i=0; i<threadCount; i++ )
+        workers.emplace_back( searchPositions );
+
+    for ( thread &iter : workers )
+        iter.join();
+
+    ////////// Output //////////
+    sort( entries.begin(), entries.end(), []( const bookEntry &a, const bookEntry &b ) { return a.key < b.key; } );
+
+    bookHeader header {};
+    memcpy( header.magic, BOOK_MAGIC, sizeof( header.magic ) );
+    header.version = BOOK_VERSION;
+    header.numEntries = entries.size();
+
+    ofstream output( fileName, std::ios::binary );
+    output.write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+    output.write( reinterpret_cast< const char * >( entries.data() ), entries.size() * sizeof( bookEntry ) );
+
+    if ( !output ) {
+
+        std::cerr << "Could not write the book to " << fileName << ".";
+        exit( EXIT_FAILURE );
+
+    }
+
+    cout << "\n" << "Book written to " << fileName << endl;
+
+}
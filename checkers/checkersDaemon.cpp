@@ -0,0 +1,517 @@
+#include "checkers.h"
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#endif
+
+using std::cout;
+using std::endl;
+using std::thread;
+using std::istringstream;
+using std::ostringstream;
+using std::shared_ptr;
+
+using namespace checkersVals;
+
+#ifdef _WIN32
+typedef SOCKET socketHandle;
+const socketHandle NO_SOCKET = INVALID_SOCKET;
+const int SEND_FLAGS = 0;
+#else
+typedef int socketHandle;
+const socketHandle NO_SOCKET = -1;
+const int SEND_FLAGS = MSG_NOSIGNAL;    // A client that disconnects fails the send instead of raising SIGPIPE
+#endif
+
+
+// Connection to a client, read by the accepting thread
+// Its requests are answered one at a time by the pool
+struct daemonClient {
+
+    socketHandle socket;
+    string buffer;                          // Received bytes not yet part of a request that was answered
+    bool skipping = false;                  // If the rest of a request that was too long is being skipped
+    std::atomic<bool> busy { false };       // If a request is being answered by the pool
+    std::atomic<bool> closing { false };    // If the client sent quit, disconnected, or could not be sent a response
+
+};
+
+
+// Returns the squares visited by a turn, e.g. c3-e5-c7
+string turnName( const turn & );
+
+// Returns the actions of a line, e.g. c3-d4 f6-e5
+string lineName( const actionLine & );
+
+// Reads what a client has sent and answers the requests it completes
+// Returns false once the client should be closed
+bool readClient( const shared_ptr< daemonClient > &, taskPool & );
+
+// Answers the complete requests of a client in order, handing each search to the pool
+void dispatchRequests( const shared_ptr< daemonClient > &, taskPool & );
+
+// Waits until a socket can be read or a number of milliseconds pass, with -1 waiting indefinitely
+int pollSockets( vector< pollfd > &, int );
+
+// Sends a whole string to a client
+// If the client has disconnected, returns false
+bool sendAll( socketHandle, const string & );
+
+// Closes a socket
+void closeSocket( socketHandle );
+
+
+///////////////////////////////////// Analysis Daemon /////////////////////////////////////
+
+// Serves analysis requests on a localhost port until the process is killed
+// Connections are read by this thread, which hands each request to the shared pool of threads
+//      The pool also runs the helper threads of MCTS searches, so idle clients do not hold any of its threads
+//      A client's requests are answered one at a time, in order
+// All searches share the transposition table and opening book
+//
+// Request lines longer than DAEMON_MAX_REQUEST bytes are answered with error request too long, and skipped
+//
+// Requests and responses are single lines:
+//      analyse <32 squares> <r|w> <seconds> [<engine>]
+//          Squares are digits in the order used by board files, with r or w for the player to move
+//          Engines: 0 = Minimax (default), 1 = MCTS (random rollouts), 2 = MCTS (heuristic rollouts)
+//      bestmove <squares of the turn, e.g. c2-d3> score <score> depth <depth>     (Minimax)
+//      bestmove <squares of the turn> iterations <iterations>                     (MCTS)
+//      multipv <32 squares> <r|w> <seconds> <lines>
+//          Searches the best turns by minimax, each with an exact score and its line
+//      lines <number of lines> depth <depth>; <squares of the turn> score <score> line <actions, e.g. c3-d4 f6-e5>; ...
+//      solve <32 squares> <r|w> [<positions>]
+//          Proves the result for the player to move by proof-number search, giving up after a number of positions
+//      result <win|loss|draw> proof <positions in the proof> nodes <positions searched> [bestmove <squares of the turn>]
+//      result unknown nodes <positions searched>
+//      error <message>
+//      save    Writes a snapshot of the table, to the snapshot file in use or else to TABLE_SNAPSHOT_FILE,
+//              and a mapped table back to its file, responding with saved
+//      quit    Closes the connection
+void board::runDaemon( int port ) {
+
+#ifdef _WIN32
+    WSADATA wsaData;
+
+    if ( WSAStartup( MAKEWORD( 2, 2 ), &wsaData ) != 0 ) {
+
+        std::cerr << "Could not start Winsock.";
+        exit( EXIT_FAILURE );
+
+    }
+#endif
+
+    socketHandle server = socket( AF_INET, SOCK_STREAM, 0 );
+
+    if ( server == NO_SOCKET ) {
+
+        std::cerr << "Could not create a socket.";
+        exit( EXIT_FAILURE );
+
+    }
+
+    // Allows the daemon to be restarted on the same port straight away
+    int reuse = 1;
+    setsockopt( server, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast< const char * >( &reuse ), sizeof( reuse ) );
+
+    // Only accepts connections from the local machine
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    address.sin_port = htons( port );
+
+    if ( bind( server, reinterpret_cast< sockaddr * >( &address ), sizeof( address ) ) != 0 || listen( server, SOMAXCONN ) != 0 ) {
+
+        std::cerr << "Could not listen on port " << port << ".";
+        exit( EXIT_FAILURE );
+
+    }
+
+    // Starts the threads before any search, so the pool has enough of them for concurrent requests
+    int numWorkers = std::max( DAEMON_WORKERS, int( thread::hardware_concurrency() ) );
+    taskPool &workers = workerPool( numWorkers );
+
+    cout << "Listening on 127.0.0.1:" << port << " with " << workers.size() << " threads" << endl;
+
+    vector< shared_ptr< daemonClient > > clients;
+    vector< pollfd > sockets;
+
+    while (1) {
+
+        // Requests buffered behind one that has just been answered are handed to the pool
+        for ( shared_ptr< daemonClient > &iter : clients )
+            dispatchRequests( iter, workers );
+
+        // Closes clients that are done, once the pool is no longer answering them
+        for ( size_t i=0; i<clients.size(); ) {
+
+            if ( clients[i]->closing && !clients[i]->busy ) {
+
+                closeSocket( clients[i]->socket );
+                clients.erase( clients.begin() + i );
+
+            }
+            else
+                i++;
+
+        }
+
+        // Only clients without a request in the pool are read, so their requests stay in order
+        //      While any request is in the pool, the wait is short, so the next requests of its client are not held up
+        sockets.assign( 1, pollfd { server, POLLIN, 0 } );
+
+        bool waiting = false;
+
+        for ( shared_ptr< daemonClient > &iter : clients ) {
+
+            if ( iter->busy )
+                waiting = true;
+            else if ( !iter->closing )
+                sockets.push_back( pollfd { iter->socket, POLLIN, 0 } );
+
+        }
+
+        if ( pollSockets( sockets, waiting ? DAEMON_POLL_MS : -1 ) <= 0 )
+            continue;
+
+        for ( size_t i=1; i<sockets.size(); i++ ) {
+
+            if ( sockets[i].revents == 0 )
+                continue;
+
+            for ( shared_ptr< daemonClient > &iter : clients ) {
+
+                if ( iter->socket == sockets[i].fd ) {
+
+                    if ( !readClient( iter, workers ) )
+                        iter->closing = true;
+
+                    break;
+
+                }
+
+            }
+
+        }
+
+        if ( sockets[0].revents & POLLIN ) {
+
+            socketHandle client = accept( server, nullptr, nullptr );
+
+            if ( client != NO_SOCKET ) {
+
+                clients.push_back( std::make_shared< daemonClient >() );
+                clients.back()->socket = client;
+
+            }
+
+        }
+
+    }
+
+}
+
+
+// Answers a single analysis or solve request
+// Returns the response line, without a newline
+string board::analyse( const string &request ) {
+
+    istringstream input( request );
+    string command, squares, player;
+    double seconds = 0;
+    int engineType = ENGINE_MINIMAX;
+    long nodeBudget = SOLVE_NODES;
+    int numLines = 1;
+
+    input >> command;
+
+    if ( command == "analyse" ) {
+
+        if ( !( input >> squares >> player >> seconds ) )
+            return "error usage: analyse <32 squares> <r|w> <seconds> [<engine>]";
+
+        if ( !( input >> engineType ) )
+            engineType = ENGINE_MINIMAX;
+
+    }
+    else if ( command == "multipv" ) {
+
+        if ( !( input >> squares >> player >> seconds >> numLines ) )
+            return "error usage: multipv <32 squares> <r|w> <seconds> <lines>";
+
+    }
+    else if ( command == "solve" ) {
+
+        if ( !( input >> squares >> player ) )
+            return "error usage: solve <32 squares> <r|w> [<positions>]";
+
+        if ( !( input >> nodeBudget ) )
+            nodeBudget = SOLVE_NODES;
+
+    }
+    else
+        return "error unknown command";
+
+    if ( squares.size() != NUM_SQUARES || squares.find_first_not_of( "01234" ) != string::npos )
+        return "error squares must be 32 digits from 0 to 4";
+
+    if ( player != "r" && player != "w" )
+        return "error player must be r or w";
+
+    if ( command != "solve" && seconds <= REMAINING_TIME_LIMIT )
+        return "error time must be positive";
+
+    if ( numLines <= 0 || numLines > MAX_TURNS )
+        return "error lines must be between 1 and " + std::to_string( MAX_TURNS );
+
+    if ( engineType < 0 || engineType >= NUM_ENGINES )
+        return "error engine must be between 0 and " + std::to_string( NUM_ENGINES-1 );
+
+    if ( nodeBudget <= 0 )
+        return "error positions must be positive";
+
+    // Board files separate the squares by whitespace
+    string spacedSquares;
+
+    for ( char iter : squares ) {
+
+        spacedSquares += iter;
+        spacedSquares += ' ';
+
+    }
+
+    istringstream squareInput( spacedSquares );
+
+    board position;
+    position.readBoard( squareInput );
+    position.loadPieces();
+    position.redTurn = ( player == "r" );
+    position.computerTime = seconds;
+    position.engine[ COLOR_RED_VAL ] = engineType;
+    position.engine[ COLOR_WHITE_VAL ] = engineType;
+
+    ostringstream response;
+
+    if ( command == "solve" ) {
+
+        static const char *RESULT_NAMES[] = { "unknown", "win", "loss", "draw" };
+        solveResult solved = position.solve( nodeBudget );
+
+        response << "result " << RESULT_NAMES[ solved.result ];
+
+        if ( solved.result != SOLVE_UNKNOWN )
+            response << " proof " << solved.proofSize;
+
+        response << " nodes " << solved.nodes;
+
+        if ( solved.result == SOLVE_WIN )
+            response << " bestmove " << turnName( solved.bestTurn );
+
+        return response.str();
+
+    }
+
+    if ( position.returnPieces() == 0 )
+        return "error no moves available";
+
+    if ( command == "multipv" ) {
+
+        vector< principalLine > lines = position.searchLines( numLines );
+
+        if ( lines.empty() )
+            return "error not enough time to search depth 1";
+
+        response << "lines " << lines.size() << " depth " << position.maxDepth;
+
+        for ( principalLine &iter : lines )
+            response << "; " << turnName( iter.rootTurn ) << " score " << iter.score << " line " << lineName( iter.moves );
+
+        return response.str();
+
+    }
+
+    // Each thread keeps its tree, so the arena is only allocated once
+    //      Requests are unrelated positions, so none of the last search is reused
+    thread_local mctsTree tree;
+    tree.reset();
+
+    int iterations = 0;
+    float score = 0;
+    actionLine line = position.searchMoves( tree, iterations, score );
+
+    // Finds the turn the best line starts with
+    turnList turns;
+    position.getCurTurnActions( position, turn(), turns );
+
+    turn *bestTurn = &turns.front();
+
+    for ( turn &iter : turns ) {
+
+        if ( iter.actions.size() <= line.size() && std::equal( iter.actions.begin(), iter.actions.end(), line.begin() ) ) {
+
+            bestTurn = &iter;
+            break;
+
+        }
+
+    }
+
+    response << "bestmove " << turnName( *bestTurn );
+
+    if ( engineType == ENGINE_MINIMAX )
+        response << " score " << score << " depth " << position.maxDepth;
+    else
+        response << " iterations " << iterations;
+
+    return response.str();
+
+}
+
+
+// Reads what a client has sent and answers the requests it completes
+// Returns false once the client should be closed
+// A request longer than DAEMON_MAX_REQUEST is answered with an error as soon as it is too long,
+//      and the rest of it is skipped up to its line end, so the buffer stays bounded
+bool readClient( const shared_ptr< daemonClient > &client, taskPool &workers ) {
+
+    char received[ 1024 ];
+    int length = recv( client->socket, received, sizeof( received ), 0 );
+
+    if ( length <= 0 )
+        return false;
+
+    client->buffer.append( received, length );
+    dispatchRequests( client, workers );
+
+    // The line end of a request that is already too long is not waited for
+    if ( !client->busy && !client->closing && client->buffer.size() > DAEMON_MAX_REQUEST ) {
+
+        if ( !client->skipping && !sendAll( client->socket, "error request too long\n" ) )
+            return false;
+
+        client->skipping = true;
+        client->buffer.clear();
+
+    }
+
+    return true;
+
+}
+
+
+// Answers the complete requests of a client in order, handing each search to the pool
+// Stops at the first request handed to the pool, and the rest wait until it has been answered
+void dispatchRequests( const shared_ptr< daemonClient > &client, taskPool &workers ) {
+
+    string request;
+    size_t newline;
+
+    while ( !client->busy && !client->closing && ( newline = client->buffer.find( '\n' ) ) != string::npos ) {
+
+        request = client->buffer.substr( 0, newline );
+        client->buffer.erase( 0, newline+1 );
+
+        if ( client->skipping ) {
+
+            client->skipping = false;
+            continue;
+
+        }
+
+        if ( !request.empty() && request.back() == '\r' )
+            request.pop_back();
+
+        if ( request == "quit" ) {
+
+            client->closing = true;
+            return;
+
+        }
+
+        if ( request.size() > DAEMON_MAX_REQUEST ) {
+
+            if ( !sendAll( client->socket, "error request too long\n" ) )
+                client->closing = true;
+
+            continue;
+
+        }
+
+        client->busy = true;
+
+        workers.submit( [client, request]() {
+
+            string response;
+
+            if ( request == "save" )
+                response = board::saveSnapshot() ? "saved" : "error could not save the table";
+            else
+                response = board::analyse( request );
+
+            if ( !sendAll( client->socket, response + "\n" ) )
+                client->closing = true;
+
+            client->busy = false;
+
+        } );
+
+    }
+
+}
+
+
+// Sends a whole string to a client
+// If the client has disconnected, returns false
+bool sendAll( socketHandle client, const string &message ) {
+
+    size_t sent = 0;
+    int length;
+
+    while ( sent < message.size() ) {
+
+        length = send( client, message.data() + sent, int( message.size() - sent ), SEND_FLAGS );
+
+        if ( length <= 0 )
+            return false;
+
+        sent += length;
+
+    }
+
+    return true;
+
+}
+
+
+// Closes a socket
+void closeSocket( socketHandle client ) {
+
+#ifdef _WIN32
+    closesocket( client );
+#else
+    close( client );
+#endif
+
+}
+
+
+// Waits until a socket can be read or a number of milliseconds pass, with -1 waiting indefinitely
+// Returns the number of sockets that can be read, or a negative number on an error
+int pollSockets( vector< pollfd > &sockets, int milliseconds ) {
+
+#ifdef _WIN32
+    return WSAPoll( sockets.data(), ULONG( sockets.size() ), milliseconds );
+#else
+    return poll( sockets.data(), nfds_t( sockets.size() ), milliseconds );
+#endif
+
+}
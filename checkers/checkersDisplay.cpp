@@ -9,7 +9,6 @@ using std::cout;
 using std::endl;
 using std::ifstream;
 using std::make_shared;
-using std::make_tuple;
 
 using namespace checkersVals;
 
@@ -57,15 +56,46 @@ void board::loadBoard() {
     }
 
     ifstream input( fileName );
+
+    if ( !readBoard( input ) ) {
+
+        std::cerr << "Specified board is invalid.";
+        exit( EXIT_FAILURE );
+
+    }
+
+}
+
+
+// Loads a board file given on the command line, with the given player to move
+void board::loadBoardFile( const string &fileName, bool redToMove ) {
+
+    ifstream input( fileName );
+
+    if ( !input || !readBoard( input ) ) {
+
+        std::cerr << "Specified board is invalid.";
+        exit( EXIT_FAILURE );
+
+    }
+
+    loadPieces();
+    redTurn = redToMove;
+
+}
+
+
+// Reads the squares of a board, in the order used by board files
+//      0: Empty, 1: White King, 2: White Man, 3: Red King, 4: Red Man
+// If there are more than 32 squares or an invalid piece, returns false
+bool board::readBoard( std::istream &input ) {
+
     int pieceNum, row = 0, col = 1;
-    tuple<int,int> tempLoc;
     shared_ptr<piece> tempPiece;
 
     // Load the board
     while ( input >> pieceNum ) {
 
-        tempLoc = make_tuple( row, col );
-
         switch ( pieceNum ) {
 
         // Empty Piece
@@ -75,10 +105,15 @@ void board::loadBoard() {
             break;
 
         // Regular Piece
-        default:
+        case 1: case 2: case 3: case 4:
 
             tempPiece = make_shared<piece>( piece( pieceNum<=2, pieceNum%2 ) );
-            tempPiece->loc = tempLoc;
+            tempPiece->loc = toSquare( row, col );
+            break;
+
+        default:
+
+            return false;
 
         }
 
@@ -86,12 +121,8 @@ void board::loadBoard() {
         // Ensure row and col are still valid
         if ( validLoc( row ) && validLoc( col ) )
             this->gameboard[ row ][ col ] = tempPiece;
-        else {
-
-            std::cerr << "Specified board is invalid. Current location: " << row;
-            exit( EXIT_FAILURE );
-
-        }
+        else
+            return false;
 
         // Update next square
         if ( col != 6 && col != 7 )
@@ -108,6 +139,8 @@ void board::loadBoard() {
 
     }
 
+    return true;
+
 }
 
 ///////////////////////////////////// Display Functions /////////////////////////////////////
@@ -199,25 +232,7 @@ void board::printStart() {
 
     printTimeSettings();
 
-    // Load piece counts
-    for ( int i=0; i<8; i++ ) {
-
-        for ( int j=0; j<8; j++ ) {
-
-            if ( gameboard[i][j]->filler == FILLER_FALSE && gameboard[i][j]->type != TYPE_EMPTY_VAL ) {
-
-                checkMoves( gameboard[i][j] );
-                gameboard[i][j]->updateCount( *this, true );
-                if( gameboard[i][j]->color == COLOR_RED_VAL )
-                    redPieces.insert(gameboard[i][j]);
-                else
-                    whitePieces.insert(gameboard[i][j]);
-
-            }
-
-        }
-
-    }
+    loadPieces();
 
     cout << "------------------- Game Begin -------------------" << "\n" << endl;
     printBoard();
@@ -291,7 +306,9 @@ void board::printPlayerSettings() {
         cout << "2 = White Goes First" << "\n";
         cout << "3 = Player vs. Computer" << "\n";
         cout << "4 = Computer vs. Computer" << "\n";
-        cout << "5 = Back" << "\n" << "\n";
+        cout << "5 = Change Red Engine" << "\n";
+        cout << "6 = Change White Engine" << "\n";
+        cout << "7 = Back" << "\n" << "\n";
 
         cout << "Current Settings: ";
         if ( redTurn )
@@ -306,7 +323,12 @@ void board::printPlayerSettings() {
         else
             cout << "3";
 
-        cout << "\n" << endl;
+        cout << "\n";
+        cout << "Red Engine: ";
+        printEngine( COLOR_RED_VAL );
+        cout << "White Engine: ";
+        printEngine( COLOR_WHITE_VAL );
+        cout << endl;
 
         while ( !validOption ) {
 
@@ -316,7 +338,7 @@ void board::printPlayerSettings() {
             if ( validateInput() )
                 continue;
 
-            if ( 1 <= option && option <= 5 )
+            if ( 1 <= option && option <= 7 )
                 validOption = true;
 
             if ( !validOption )
@@ -346,8 +368,19 @@ void board::printPlayerSettings() {
             this->AIvsAI = true;
             break;
 
+        // Cycles through the engines
         case 5:
 
+            this->engine[ COLOR_RED_VAL ] = ( this->engine[ COLOR_RED_VAL ] + 1 ) % NUM_ENGINES;
+            break;
+
+        case 6:
+
+            this->engine[ COLOR_WHITE_VAL ] = ( this->engine[ COLOR_WHITE_VAL ] + 1 ) % NUM_ENGINES;
+            break;
+
+        case 7:
+
             return;
 
         }
@@ -480,7 +513,7 @@ void board::printAddPiece() {
 
             validType = true;
             gameboard[row][col] = make_shared<piece> ( piece(pieceType<=2, pieceType%2) );
-            gameboard[row][col]->loc = make_tuple( row, col );
+            gameboard[row][col]->loc = toSquare( row, col );
 
         }
         else if ( pieceType == 5 )
@@ -665,6 +698,31 @@ void board::printHelp() {
 }
 
 
+// Prints the engine used by a color
+void board::printEngine( bool color ) {
+
+    switch ( this->engine[ color ] ) {
+
+    case ENGINE_MINIMAX:
+
+        cout << "Minimax" << "\n";
+        break;
+
+    case ENGINE_MCTS_RANDOM:
+
+        cout << "Monte Carlo Tree Search (random rollouts)" << "\n";
+        break;
+
+    case ENGINE_MCTS_HEURISTIC:
+
+        cout << "Monte Carlo Tree Search (heuristic rollouts)" << "\n";
+        break;
+
+    }
+
+}
+
+
 // Prints an error message
 void board::printError() {
 
@@ -0,0 +1,227 @@
+#include "checkers.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+///////////////////////////////////// Memory-Mapped Files /////////////////////////////////////
+
+// Destructor
+// Unmaps the file
+mappedFile::~mappedFile() {
+
+    close();
+
+}
+
+
+// Maps a file into memory for reading
+// If the file cannot be opened or is empty, returns false
+bool mappedFile::open( const string &fileName ) {
+
+    close();
+
+#ifdef _WIN32
+
+    fileHandle = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+    if ( fileHandle == INVALID_HANDLE_VALUE ) {
+
+        fileHandle = nullptr;
+        return false;
+
+    }
+
+    LARGE_INTEGER fileSize;
+
+    if ( !GetFileSizeEx( fileHandle, &fileSize ) || fileSize.QuadPart == 0 ) {
+
+        close();
+        return false;
+
+    }
+
+    mapHandle = CreateFileMappingA( fileHandle, NULL, PAGE_READONLY, 0, 0, NULL );
+
+    if ( mapHandle == NULL ) {
+
+        mapHandle = nullptr;
+        close();
+        return false;
+
+    }
+
+    view = static_cast< char * >( MapViewOfFile( mapHandle, FILE_MAP_READ, 0, 0, 0 ) );
+
+    if ( view == nullptr ) {
+
+        close();
+        return false;
+
+    }
+
+    length = size_t( fileSize.QuadPart );
+
+#else
+
+    int fd = ::open( fileName.c_str(), O_RDONLY );
+
+    if ( fd == -1 )
+        return false;
+
+    struct stat fileInfo;
+
+    if ( fstat( fd, &fileInfo ) == -1 || fileInfo.st_size == 0 ) {
+
+        ::close( fd );
+        return false;
+
+    }
+
+    void *mapping = mmap( nullptr, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+    // The mapping stays valid after the file is closed
+    ::close( fd );
+
+    if ( mapping == MAP_FAILED )
+        return false;
+
+    view = static_cast< char * >( mapping );
+    length = size_t( fileInfo.st_size );
+
+#endif
+
+    return true;
+
+}
+
+
+// Maps a file into memory for reading and writing, creating it or resizing it to the given size
+// Changes are written back to the file
+// If the file cannot be created or mapped, returns false
+bool mappedFile::create( const string &fileName, size_t fileSize ) {
+
+    close();
+
+#ifdef _WIN32
+
+    fileHandle = CreateFileA( fileName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+
+    if ( fileHandle == INVALID_HANDLE_VALUE ) {
+
+        fileHandle = nullptr;
+        return false;
+
+    }
+
+    // Resizes the file
+    LARGE_INTEGER newSize;
+    newSize.QuadPart = LONGLONG( fileSize );
+
+    if ( !SetFilePointerEx( fileHandle, newSize, NULL, FILE_BEGIN ) || !SetEndOfFile( fileHandle ) ) {
+
+        close();
+        return false;
+
+    }
+
+    mapHandle = CreateFileMappingA( fileHandle, NULL, PAGE_READWRITE, 0, 0, NULL );
+
+    if ( mapHandle == NULL ) {
+
+        mapHandle = nullptr;
+        close();
+        return false;
+
+    }
+
+    view = static_cast< char * >( MapViewOfFile( mapHandle, FILE_MAP_WRITE, 0, 0, 0 ) );
+
+    if ( view == nullptr ) {
+
+        close();
+        return false;
+
+    }
+
+#else
+
+    int fd = ::open( fileName.c_str(), O_RDWR | O_CREAT, 0644 );
+
+    if ( fd == -1 )
+        return false;
+
+    if ( ftruncate( fd, fileSize ) == -1 ) {
+
+        ::close( fd );
+        return false;
+
+    }
+
+    void *mapping = mmap( nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    // The mapping stays valid after the file is closed
+    ::close( fd );
+
+    if ( mapping == MAP_FAILED )
+        return false;
+
+    view = static_cast< char * >( mapping );
+
+#endif
+
+    length = fileSize;
+
+    return true;
+
+}
+
+
+// Writes changes to a file mapped for writing back to the file
+void mappedFile::flush() {
+
+    if ( view == nullptr )
+        return;
+
+#ifdef _WIN32
+    FlushViewOfFile( view, 0 );
+    FlushFileBuffers( fileHandle );
+#else
+    msync( view, length, MS_SYNC );
+#endif
+
+}
+
+
+// Unmaps the file
+void mappedFile::close() {
+
+#ifdef _WIN32
+
+    if ( view != nullptr )
+        UnmapViewOfFile( view );
+    if ( mapHandle != nullptr )
+        CloseHandle( mapHandle );
+    if ( fileHandle != nullptr )
+        CloseHandle( fileHandle );
+
+    mapHandle = nullptr;
+    fileHandle = nullptr;
+
+#else
+
+    if ( view != nullptr )
+        munmap( view, length );
+
+#endif
+
+    view = nullptr;
+    length = 0;
+
+}
@@ -0,0 +1,386 @@
+#include "checkers.h"
+#include <cmath>
+#include <random>
+#include <thread>
+#include <functional>
+
+using std::thread;
+using std::atomic;
+using std::pair;
+using std::make_pair;
+using std::max;
+
+using namespace checkersVals;
+
+// PRNG used for rollouts
+// Each thread has its own generator, seeded with the time and the thread id
+static thread_local std::mt19937 rng( std::chrono::steady_clock::now().time_since_epoch().count()
+                                      ^ std::hash<std::thread::id>()( std::this_thread::get_id() ) );
+static thread_local std::uniform_real_distribution<float> chance(0,1);
+
+
+///////////////////////////////////// Search Tree /////////////////////////////////////
+
+// Constructor
+// The arena is only allocated once a search uses the tree
+mctsTree::mctsTree() {
+
+    next = 0;
+
+}
+
+
+// Allocates the arena on first use and clears it once more than half of it is used
+// Called before each search
+void mctsTree::prepare() {
+
+    if ( !nodes ) {
+
+        nodes.reset( new mctsNode[ MCTS_MAX_NODES ] );
+        reset();
+
+    }
+    else if ( next > MCTS_MAX_NODES/2 )
+        reset();
+
+}
+
+
+// Clears the tree, leaving an unexpanded root
+void mctsTree::reset() {
+
+    // Tree has not been used yet
+    if ( !nodes )
+        return;
+
+    root = 0;
+    next = 1;
+
+    nodes[0].firstChild = -1;
+    nodes[0].numChildren = 0;
+    nodes[0].state = NODE_LEAF;
+    nodes[0].visits = 0;
+    nodes[0].points = 0;
+
+}
+
+
+// Moves the root to the child reached by a turn
+// If the turn is not in the tree, clears the tree
+void mctsTree::advance( const turn &played ) {
+
+    // Tree has not been used yet
+    if ( !nodes )
+        return;
+
+    mctsNode &rootNode = nodes[ root ];
+
+    if ( rootNode.state == NODE_EXPANDED ) {
+
+        for ( int i=rootNode.firstChild; i<rootNode.firstChild+rootNode.numChildren; i++ ) {
+
+            if ( nodes[i].move.actions == played.actions ) {
+
+                root = i;
+                return;
+
+            }
+
+        }
+
+    }
+
+    reset();
+
+}
+
+
+// Reserves a block of nodes and returns the index of the first
+// If the arena is full, returns -1
+int mctsTree::allocate( int count ) {
+
+    int first = next.fetch_add( count );
+
+    if ( first + count > MCTS_MAX_NODES )
+        return -1;
+
+    return first;
+
+}
+
+
+///////////////////////////////////// Search /////////////////////////////////////
+
+// Searches from the current board across all cores until the time limit
+// Returns the actions of the most visited turn, and the number of iterations through iterations
+actionLine board::mctsSearch( mctsTree &tree, int &iterations ) {
+
+    atomic<bool> stop( false );
+    atomic<int> count( 0 );
+    actionLine bestMoves;
+
+    tree.prepare();
+
+    // The root is expanded before the threads start so every thread has children to select from
+    if ( tree[ tree.root ].state != mctsTree::NODE_EXPANDED )
+        mctsExpand( tree, tree.root );
+
+    // The current thread searches as well, joined by free threads of the shared pool
+    int threadCount = ( this->numThreads > 0 ) ? this->numThreads : max( 1, int( thread::hardware_concurrency() ) );
+
+    workerPool().parallel( threadCount, [&]( int ) { mctsWorker( tree, stop, count ); } );
+
+    // Plays the most visited turn
+    mctsNode &rootNode = tree[ tree.root ];
+    int best = rootNode.firstChild;
+
+    for ( int i=rootNode.firstChild; i<rootNode.firstChild+rootNode.numChildren; i++ ) {
+
+        if ( tree[i].visits > tree[ best ].visits )
+            best = i;
+
+    }
+
+    for ( action iter : tree[ best ].move.actions )
+        bestMoves.push_back( iter );
+
+    iterations = count;
+    return bestMoves;
+
+}
+
+
+// Runs iterations of the search until the time limit is reached by any thread
+void board::mctsWorker( mctsTree &tree, atomic<bool> &stop, atomic<int> &count ) {
+
+    // Nodes along the path of an iteration, with the color of the player who made the move of each node
+    vector< pair<int,bool> > path;
+    std::chrono::duration<double> elapsed;
+
+    while ( !stop ) {
+
+        mctsIteration( tree, path );
+        count++;
+
+        elapsed = std::chrono::system_clock::now() - this->startTime;
+        if ( this->computerTime - elapsed.count() < REMAINING_TIME_LIMIT )
+            stop = true;
+
+    }
+
+}
+
+
+// Selects a path down the tree from the current board, expands its leaf and backs up a rollout result
+// Nodes along the path carry a virtual loss while the iteration runs, steering other threads to other paths
+void board::mctsIteration( mctsTree &tree, vector< pair<int,bool> > &path ) {
+
+    // Pieces are copied as they are affected by actions, so the current board is not changed
+    board simBoard = *this;
+    int index = tree.root;
+
+    path.clear();
+    path.push_back( make_pair( index, redTurn ? COLOR_WHITE_VAL : COLOR_RED_VAL ) );
+    tree[ index ].visits += MCTS_VIRTUAL_LOSS;
+
+    // Selection
+    while ( tree[ index ].state == mctsTree::NODE_EXPANDED && tree[ index ].numChildren > 0 ) {
+
+        index = mctsSelect( tree, index );
+        path.push_back( make_pair( index, simBoard.redTurn ? COLOR_RED_VAL : COLOR_WHITE_VAL ) );
+        tree[ index ].visits += MCTS_VIRTUAL_LOSS;
+
+        simBoard.applyTurn( tree[ index ].move );
+
+    }
+
+    // Expansion
+    // A leaf is played out once before it is expanded
+    // Only one thread expands a leaf; others play it out in the meantime
+    mctsNode &leaf = tree[ index ];
+    int expected = mctsTree::NODE_LEAF;
+
+    if ( leaf.visits >= MCTS_EXPAND_VISITS + MCTS_VIRTUAL_LOSS && leaf.state.compare_exchange_strong( expected, mctsTree::NODE_EXPANDING ) ) {
+
+        simBoard.mctsExpand( tree, index );
+
+        if ( leaf.state == mctsTree::NODE_EXPANDED && leaf.numChildren > 0 ) {
+
+            index = mctsSelect( tree, index );
+            path.push_back( make_pair( index, simBoard.redTurn ? COLOR_RED_VAL : COLOR_WHITE_VAL ) );
+            tree[ index ].visits += MCTS_VIRTUAL_LOSS;
+
+            simBoard.applyTurn( tree[ index ].move );
+
+        }
+
+    }
+
+    // Simulation
+    int redPoints = simBoard.mctsRollout( this->engine[ redTurn ? COLOR_RED_VAL : COLOR_WHITE_VAL ] );
+
+    // Backpropagation
+    // Replaces the virtual loss with the result
+    for ( pair<int,bool> &iter : path ) {
+
+        tree[ iter.first ].visits += 1 - MCTS_VIRTUAL_LOSS;
+        tree[ iter.first ].points += ( iter.second == COLOR_RED_VAL ) ? redPoints : 2 - redPoints;
+
+    }
+
+}
+
+
+// Creates the children of a node for the turns available on the current board
+// If the arena is full, the node is left marked as expanding so it stays a leaf
+void board::mctsExpand( mctsTree &tree, int index ) {
+
+    turnList turns;
+    getCurTurnActions( *this, turn(), turns );
+
+    int first = tree.allocate( turns.size() );
+
+    if ( first == -1 )
+        return;
+
+    for ( int i=0; i<turns.size(); i++ ) {
+
+        mctsNode &child = tree[ first+i ];
+
+        child.move = turns[i];
+        child.firstChild = -1;
+        child.numChildren = 0;
+        child.state = mctsTree::NODE_LEAF;
+        child.visits = 0;
+        child.points = 0;
+
+    }
+
+    tree[ index ].firstChild = first;
+    tree[ index ].numChildren = turns.size();
+
+    // Children are visible to other threads once the node is marked as expanded
+    tree[ index ].state = mctsTree::NODE_EXPANDED;
+
+}
+
+
+// Returns the child of a node with the highest UCT value
+// Unvisited children are tried first
+int board::mctsSelect( mctsTree &tree, int index ) {
+
+    mctsNode &node = tree[ index ];
+    float logVisits = log( float( max( int( node.visits ), 1 ) ) );
+    float value, bestValue = -1;
+    int visits, best = node.firstChild;
+
+    for ( int i=node.firstChild; i<node.firstChild+node.numChildren; i++ ) {
+
+        visits = tree[i].visits;
+
+        if ( visits <= 0 )
+            return i;
+
+        value = tree[i].points / ( 2.0f * visits ) + MCTS_EXPLORATION * sqrt( logVisits / visits );
+
+        if ( value > bestValue ) {
+
+            bestValue = value;
+            best = i;
+
+        }
+
+    }
+
+    return best;
+
+}
+
+
+// Plays the current board out and returns the result for Red: 2 for a win, 1 for a draw, 0 for a loss
+// Random rollouts pick a random piece and a random action for it
+// Heuristic-biased rollouts play the turn with the best heuristic score, with a small chance of a random turn
+int board::mctsRollout( int engineType ) {
+
+    turnList turns;
+    unsigned int possibleMoves;
+    pieceActions *possibleActions;
+    action curAction;
+    bool multiJump;
+
+    for ( int turnNum=0; turnNum<MCTS_ROLLOUT_LIMIT; turnNum++ ) {
+
+        possibleMoves = returnPieces();
+
+        // The player to move loses if there are no actions available
+        if ( possibleMoves == 0 )
+            return redTurn ? 0 : 2;
+
+        if ( engineType == ENGINE_MCTS_HEURISTIC && chance( rng ) >= MCTS_ROLLOUT_EPSILON ) {
+
+            int bestTurn = 0;
+            float tempScore, bestScore = VAL_MIN;
+
+            turns.clear();
+            getCurTurnActions( *this, turn(), turns );
+
+            for ( int i=0; i<turns.size(); i++ ) {
+
+                board tempBoard = *this;
+                tempBoard.applyTurn( turns[i] );
+                tempBoard.heuristic();
+
+                // Score for the player to move
+                tempScore = redTurn ? tempBoard.score : -tempBoard.score;
+
+                if ( tempScore > bestScore ) {
+
+                    bestScore = tempScore;
+                    bestTurn = i;
+
+                }
+
+            }
+
+            applyTurn( turns[ bestTurn ] );
+
+        }
+        else {
+
+            multiJump = true;
+
+            while ( multiJump ) {
+
+                // Skips to a random piece
+                for ( int skip = rng() % countSquares( possibleMoves ); skip > 0; skip-- )
+                    possibleMoves &= possibleMoves - 1;
+
+                possibleActions = squareAt( firstSquare( possibleMoves ) )->returnActions();
+                curAction = (*possibleActions)[ rng() % possibleActions->size() ];
+
+                isolateBoard( curAction );
+                multiJump = moveResult( curAction );
+
+                // Only the jumping piece is available during a multi-jump
+                possibleMoves = returnPieces();
+
+            }
+
+            redTurn = !redTurn;
+            turnCount++;
+
+        }
+
+    }
+
+    // Scores an unfinished rollout by the heuristic
+    heuristic();
+
+    if ( score > MCTS_ROLLOUT_MARGIN )
+        return 2;
+    else if ( score < -MCTS_ROLLOUT_MARGIN )
+        return 0;
+    else
+        return 1;
+
+}
@@ -0,0 +1,280 @@
+#include "checkers.h"
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <mutex>
+
+using std::cout;
+using std::endl;
+using std::thread;
+using std::atomic;
+using std::mutex;
+using std::lock_guard;
+using std::max;
+using std::min;
+
+using namespace checkersVals;
+
+
+// Converts an Elo difference to the expected score per game
+double eloToScore( double );
+
+// Converts a score per game to an Elo difference
+double scoreToElo( double );
+
+
+///////////////////////////////////// Engine Matches /////////////////////////////////////
+
+// Plays a headless match between engines A and B across all cores
+// Each pair of games starts from the same random opening, with A playing Red in one and White in the other
+// Stops early once a sequential probability ratio test of elo0 against elo1 (for A) is conclusive
+//      The verdict is the one reached when the test first crosses a bound; games still running then are reported separately
+void board::playMatch( int engineA, double timeA, int engineB, double timeB, int games, float elo0, float elo1 ) {
+
+    if ( engineA < 0 || engineA >= NUM_ENGINES || engineB < 0 || engineB >= NUM_ENGINES ) {
+
+        std::cerr << "Engines must be between 0 and " << NUM_ENGINES-1 << ".";
+        exit( EXIT_FAILURE );
+
+    }
+    if ( timeA <= REMAINING_TIME_LIMIT || timeB <= REMAINING_TIME_LIMIT || games <= 0 ) {
+
+        std::cerr << "Times and the number of games must be positive.";
+        exit( EXIT_FAILURE );
+
+    }
+    if ( games % 2 != 0 ) {
+
+        std::cerr << "The number of games must be even, since each opening is played once with each color.";
+        exit( EXIT_FAILURE );
+
+    }
+
+    int numPairs = games / 2;
+    unsigned int seed = std::chrono::steady_clock::now().time_since_epoch().count();
+
+    atomic<int> nextPair( 0 );
+    atomic<bool> stop( false );
+
+    // Results for A, updated by all threads
+    mutex resultLock;
+    int wins = 0, draws = 0, losses = 0;
+    double llr = 0;
+
+    // Verdict of the SPRT when it first crosses a bound: +1 if elo1 is accepted, -1 if elo0 is accepted, 0 if neither
+    int verdict = 0;
+    double verdictLlr = 0;
+    int verdictGames = 0;
+
+    // SPRT bounds
+    double lowerBound = log( SPRT_BETA / ( 1 - SPRT_ALPHA ) );
+    double upperBound = log( ( 1 - SPRT_BETA ) / SPRT_ALPHA );
+
+    cout << "Seed: " << seed << "\n" << endl;
+
+    // Each thread plays pairs of games until all games are played or the SPRT stops the match
+    auto playPairs = [&]() {
+
+        // Each engine keeps its search state between its turns, and starts each game with it cleared
+        vector< engineContext > engines( 2 );
+        int pairNum;
+
+        while ( !stop && ( pairNum = nextPair++ ) < numPairs ) {
+
+            board opening;
+            opening.loadPieces();
+            opening.randomOpening( seed + pairNum );
+
+            for ( int game=0; game<2 && !stop; game++ ) {
+
+                // A plays Red in the first game of the pair and White in the second
+                bool colorA = ( game == 0 ) ? COLOR_RED_VAL : COLOR_WHITE_VAL;
+                double times[2];
+
+                board gameBoard = opening;
+                gameBoard.numThreads = 1;
+                gameBoard.engine[ colorA ] = engineA;
+                gameBoard.engine[ !colorA ] = engineB;
+                times[ colorA ] = timeA;
+                times[ !colorA ] = timeB;
+
+                int redPoints = gameBoard.playHeadless( engines.data(), times );
+                int points = ( colorA == COLOR_RED_VAL ) ? redPoints : 2 - redPoints;
+
+                lock_guard< mutex > lock( resultLock );
+
+                if ( points == 2 )
+                    wins++;
+                else if ( points == 1 )
+                    draws++;
+                else
+                    losses++;
+
+                // Score per game
+                double numGames = wins + draws + losses;
+                double score = ( wins + 0.5*draws ) / numGames;
+
+                // Variance of the score per game
+                // Each result is counted with an extra half game so a one-sided match still has a variance
+                double priorScore = ( wins + 0.5*draws + 0.75 ) / ( numGames + 1.5 );
+                double variance = ( ( wins+0.5 ) * pow( 1-priorScore, 2 ) + ( draws+0.5 ) * pow( 0.5-priorScore, 2 )
+                                    + ( losses+0.5 ) * pow( priorScore, 2 ) ) / ( numGames + 1.5 );
+
+                // Elo with a 95% confidence interval
+                double margin = 1.96 * sqrt( variance / numGames );
+                double elo = scoreToElo( score );
+                double eloError = ( scoreToElo( score + margin ) - scoreToElo( score - margin ) ) / 2;
+
+                // Log-likelihood ratio of elo1 against elo0, using a normal approximation of the score per game
+                double score0 = eloToScore( elo0 );
+                double score1 = eloToScore( elo1 );
+
+                llr = ( score1 - score0 ) * ( 2*score - score0 - score1 ) * numGames / ( 2*variance );
+
+                cout << "Games: " << numGames
+                     << "  W/D/L: " << wins << "/" << draws << "/" << losses
+                     << "  Elo: " << elo << " +/- " << eloError
+                     << "  LLR: " << llr << " (" << lowerBound << ", " << upperBound << ")" << endl;
+
+                if ( verdict == 0 && ( llr <= lowerBound || llr >= upperBound ) ) {
+
+                    verdict = ( llr >= upperBound ) ? 1 : -1;
+                    verdictLlr = llr;
+                    verdictGames = int( numGames );
+                    stop = true;
+
+                }
+
+            }
+
+        }
+
+    };
+
+    int threadCount = max( 1, int( thread::hardware_concurrency() ) );
+    vector< thread > workers;
+
+    for ( int i=0; i<threadCount; i++ )
+        workers.emplace_back( playPairs );
+
+    for ( thread &iter : workers )
+        iter.join();
+
+    cout << "\n";
+    if ( verdict == 1 )
+        cout << "SPRT: Elo " << elo1 << " accepted for A after " << verdictGames << " games (LLR: " << verdictLlr << ")" << endl;
+    else if ( verdict == -1 )
+        cout << "SPRT: Elo " << elo0 << " accepted for A after " << verdictGames << " games (LLR: " << verdictLlr << ")" << endl;
+    else
+        cout << "SPRT: Inconclusive" << endl;
+
+    // Games that were already running when the test stopped are not part of the verdict
+    int extraGames = wins + draws + losses - verdictGames;
+
+    if ( verdict != 0 && extraGames > 0 )
+        cout << extraGames << " games finished after the test stopped, not counted in the verdict (LLR with them: " << llr << ")" << endl;
+
+}
+
+
+// Plays random turns from the current board to create a match opening
+void board::randomOpening( unsigned int seed ) {
+
+    std::mt19937 openingRng( seed );
+    turnList turns;
+
+    for ( int i=0; i<MATCH_OPENING_TURNS; i++ ) {
+
+        turns.clear();
+        getCurTurnActions( *this, turn(), turns );
+
+        if ( turns.empty() )
+            return;
+
+        applyTurn( turns[ openingRng() % turns.size() ] );
+
+    }
+
+}
+
+
+// Plays a game from the current board without any output
+// Uses the engine of each color, with its own search state and a time per move for each color
+//      The states are cleared first, so a game does not depend on the games played before it
+// Games that are not decided after MATCH_MAX_TURNS turns are draws
+// Returns the result for Red: 2 for a win, 1 for a draw, 0 for a loss
+int board::playHeadless( engineContext *engines, const double *times ) {
+
+    actionLine futureMoves;
+    turn playedTurn;
+    bool color, multiJump;
+    int iterations, actionNum;
+    float futureScore;
+
+    for ( int player=0; player<2; player++ ) {
+
+        engines[ player ].tree.reset();
+        engines[ player ].table.clear();
+        engines[ player ].evals.clear();
+
+    }
+
+    for ( int turnNum=0; turnNum<MATCH_MAX_TURNS; turnNum++ ) {
+
+        // The player to move loses if there are no actions available
+        if ( returnPieces() == 0 )
+            return redTurn ? 0 : 2;
+
+        color = redTurn ? COLOR_RED_VAL : COLOR_WHITE_VAL;
+        this->computerTime = times[ color ];
+        this->searchTable = &engines[ color ].table;
+        this->searchEvals = &engines[ color ].evals;
+        futureMoves = searchMoves( engines[ color ].tree, iterations, futureScore );
+
+        // Performs the actions of the first turn of the best line
+        // Pieces may be shared with other boards, so they are copied before they are changed
+        playedTurn = turn();
+        multiJump = true;
+        actionNum = 0;
+
+        while ( multiJump ) {
+
+            action curAction = futureMoves[ actionNum++ ];
+            playedTurn.actions.push_back( curAction );
+
+            isolateBoard( curAction );
+            multiJump = moveResult( curAction );
+
+        }
+
+        redTurn = !redTurn;
+        turnCount++;
+        moves.clear();
+
+        engines[ COLOR_RED_VAL ].tree.advance( playedTurn );
+        engines[ COLOR_WHITE_VAL ].tree.advance( playedTurn );
+
+    }
+
+    return 1;
+
+}
+
+
+// Converts an Elo difference to the expected score per game
+double eloToScore( double elo ) {
+
+    return 1 / ( 1 + pow( 10, -elo/400 ) );
+
+}
+
+
+// Converts a score per game to an Elo difference
+// Scores are clamped so a perfect score gives a finite difference
+double scoreToElo( double score ) {
+
+    score = min( max( score, 0.001 ), 0.999 );
+    return 400 * log10( score / ( 1-score ) );
+
+}
@@ -0,0 +1,138 @@
+#include "checkers.h"
+
+using std::thread;
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+using std::max;
+
+
+///////////////////////////////////// Task Pool /////////////////////////////////////
+
+// Starts the threads, which wait for tasks
+taskPool::taskPool( int numThreads ) {
+
+    for ( int i=0; i<numThreads; i++ )
+        threads.emplace_back( &taskPool::workerLoop, this );
+
+}
+
+
+// Stops and joins the threads once they finish their current tasks
+// Tasks still queued are not run
+taskPool::~taskPool() {
+
+    {
+        lock_guard< mutex > guard( lock );
+        stopping = true;
+    }
+
+    available.notify_all();
+
+    for ( thread &iter : threads )
+        iter.join();
+
+}
+
+
+// Queues a task to be run by the next free thread
+void taskPool::submit( std::function< void() > task ) {
+
+    {
+        lock_guard< mutex > guard( lock );
+        tasks.push_back( std::move( task ) );
+    }
+
+    available.notify_one();
+
+}
+
+
+// Runs a function on up to count threads, each given its own index, and waits for them
+// The calling thread runs index 0, and free threads of the pool run the other indices
+//      Indices not yet started when index 0 finishes are skipped, so the caller never waits on a busy pool
+void taskPool::parallel( int count, const std::function< void( int ) > &function ) {
+
+    // Shared with the queued tasks, which may outlive the call if they are skipped
+    struct taskGroup {
+
+        mutex lock;
+        std::condition_variable finished;
+        int running = 0;
+        bool closed = false;
+
+    };
+
+    std::shared_ptr< taskGroup > group = std::make_shared< taskGroup >();
+
+    // Without threads, nothing would run the queued indices, so they are not queued
+    if ( threads.empty() )
+        count = 1;
+
+    for ( int index=1; index<count; index++ ) {
+
+        submit( [group, &function, index]() {
+
+            {
+                lock_guard< mutex > guard( group->lock );
+
+                if ( group->closed )
+                    return;
+
+                group->running++;
+            }
+
+            function( index );
+
+            lock_guard< mutex > guard( group->lock );
+            group->running--;
+            group->finished.notify_all();
+
+        } );
+
+    }
+
+    function( 0 );
+
+    unique_lock< mutex > guard( group->lock );
+    group->closed = true;
+    group->finished.wait( guard, [&]() { return group->running == 0; } );
+
+}
+
+
+// Runs queued tasks until the pool is destroyed
+void taskPool::workerLoop() {
+
+    while (1) {
+
+        std::function< void() > task;
+
+        {
+            unique_lock< mutex > guard( lock );
+            available.wait( guard, [this]() { return stopping || !tasks.empty(); } );
+
+            if ( stopping )
+                return;
+
+            task = std::move( tasks.front() );
+            tasks.pop_front();
+        }
+
+        task();
+
+    }
+
+}
+
+
+// Returns the threads shared by searches, starting them on first use
+// The first call sets the number of threads, or uses one less than the number of cores, since callers also run a share
+//      There is always at least one thread, so tasks submitted on a single core are still run
+//      The daemon calls it first, with enough threads to answer its requests as well
+taskPool &board::workerPool( int numThreads ) {
+
+    static taskPool pool( ( numThreads > 0 ) ? numThreads : max( 1, int( thread::hardware_concurrency() ) - 1 ) );
+    return pool;
+
+}
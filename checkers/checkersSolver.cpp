@@ -0,0 +1,447 @@
+#include "checkers.h"
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+using std::cout;
+using std::endl;
+using std::unordered_map;
+using std::unordered_set;
+using std::min;
+
+using namespace checkersVals;
+
+
+// Returns the squares visited by a turn, e.g. c3-e5-c7
+string turnName( const turn & );
+
+// Proof and disproof numbers of a position, for the player trying to force a win
+//      The proof number is the smallest number of positions that must still be proven for the win to be forced, 0 once it is
+//      The disproof number is the same for showing the win cannot be forced, 0 once it is shown
+struct proofNumbers {
+
+    unsigned int proof = 1;
+    unsigned int disproof = 1;
+
+};
+
+// Turns left a position is solved with
+// A win proven with some turns left is also forced with more turns left,
+//      and a win disproven with some turns left cannot be forced with fewer
+struct solvedEntry {
+
+    int provenTurns = -1;       // Fewest turns left the win was proven with, -1 if it was not
+    int disprovenTurns = -1;    // Most turns left the win was disproven with, -1 if it was not
+
+};
+
+// State of a depth-first proof-number search
+struct proofSearch {
+
+    bool attacker;          // Color trying to force a win
+    int horizon = 0;        // Turns left at the root, 0 before the first iteration
+    long nodeBudget;        // Positions that can be searched before giving up
+    long nodes = 0;         // Positions searched
+    bool exhausted = false; // Set once a budget runs out
+    bool cutOff = false;    // Set once a position runs out of turns, so a disproof may not hold with more turns
+
+    unordered_map< unsigned long long, solvedEntry > solved;    // Solved positions, by Zobrist key
+    unordered_map< unsigned long long, proofNumbers > numbers;  // Numbers of unsolved positions, by the key from searchKey
+
+};
+
+// Returns the key of a position with a number of turns left, for the numbers of an unsolved search
+unsigned long long searchKey( unsigned long long, int );
+
+// Returns the numbers of a position with a number of turns left
+// Positions not searched yet start at 1
+proofNumbers lookupNumbers( const proofSearch &, unsigned long long, int );
+
+// Stores the numbers of a position with a number of turns left
+void storeNumbers( proofSearch &, unsigned long long, int, const proofNumbers & );
+
+// Adds proof or disproof numbers, keeping solved positions at infinity
+unsigned int addNumbers( unsigned int, unsigned int );
+
+
+///////////////////////////////////// Proof-Number Search /////////////////////////////////////
+
+// Proves the result of the board for the player to move by depth-first proof-number search (df-pn)
+// Wins for the player to move and for the other player are searched separately, each with its own table
+//      If neither player can force a win, the result is a draw
+// Wins must be forced within SOLVE_MAX_TURNS turns, so kings moving back and forth cannot make the search loop
+//      and every result holds whichever line the position is reached by
+solveResult board::solve( long nodeBudget ) {
+
+    solveResult result;
+    bool color = redTurn ? COLOR_RED_VAL : COLOR_WHITE_VAL;
+    unsigned long long key = hashKey();
+
+    proofSearch win, loss;
+    win.attacker = color;
+    loss.attacker = !color;
+
+    // Short wins for either player are found first by doubling the turns left at the root
+    // Entries are stored with the turns left they hold for, so they are kept between iterations
+    for ( int horizon = SOLVE_FIRST_TURNS; ; horizon = min( 2*horizon, SOLVE_MAX_TURNS ) ) {
+
+        for ( proofSearch *search : { &win, &loss } ) {
+
+            // A disproof that never ran out of turns holds with any number of turns
+            if ( search->horizon > 0 && !search->cutOff )
+                continue;
+
+            search->horizon = horizon;
+            search->nodeBudget = search->nodes + nodeBudget - win.nodes - loss.nodes;
+            proveNode( *search, horizon, SOLVE_INFINITY, SOLVE_INFINITY );
+
+            result.nodes = win.nodes + loss.nodes;
+
+            if ( search->exhausted )
+                return result;
+
+            if ( lookupNumbers( *search, key, horizon ).proof == 0 ) {
+
+                result.result = ( search == &win ) ? SOLVE_WIN : SOLVE_LOSS;
+                result.proofSize = proofTreeSize( *search, true );
+                break;
+
+            }
+
+        }
+
+        if ( result.result != SOLVE_UNKNOWN )
+            break;
+
+        if ( horizon == SOLVE_MAX_TURNS || ( !win.cutOff && !loss.cutOff ) ) {
+
+            result.result = SOLVE_DRAW;
+            result.proofSize = proofTreeSize( win, false ) + proofTreeSize( loss, false );
+            return result;
+
+        }
+
+    }
+
+    // Finds a turn to a proven position
+    if ( result.result == SOLVE_WIN ) {
+
+        turnList turns;
+        getCurTurnActions( *this, turn(), turns );
+
+        for ( turn &iter : turns ) {
+
+            board tempBoard = *this;
+            tempBoard.applyTurn( iter );
+
+            if ( lookupNumbers( win, tempBoard.hashKey(), win.horizon-1 ).proof == 0 ) {
+
+                result.bestTurn = iter;
+                break;
+
+            }
+
+        }
+
+    }
+
+    return result;
+
+}
+
+
+// Searches the board until its proof number reaches proofLimit or its disproof number reaches disproofLimit
+//      When the attacker is to move, the board is proven by any turn and disproven by all of them
+//      When the defender is to move, the board is proven by all turns and disproven by any of them
+// The child with the smallest number is searched until it is no longer the smallest, as found from the second smallest
+void board::proveNode( proofSearch &search, int turnsLeft, unsigned int proofLimit, unsigned int disproofLimit ) {
+
+    if ( ++search.nodes > search.nodeBudget || search.solved.size() + search.numbers.size() >= SOLVE_ENTRIES ) {
+
+        search.exhausted = true;
+        return;
+
+    }
+
+    unsigned long long key = hashKey();
+    bool attackerTurn = ( redTurn ? COLOR_RED_VAL : COLOR_WHITE_VAL ) == search.attacker;
+    proofNumbers current;
+
+    // Kept on the heap, since lines can be long
+    vector< board > children;
+    expandNode( children );
+
+    // No turns available, so the player to move loses
+    // Otherwise, the win cannot be forced once no turns are left
+    if ( children.empty() || turnsLeft == 0 ) {
+
+        bool proven = children.empty() && !attackerTurn;
+        search.cutOff |= !children.empty();
+        current.proof = proven ? 0 : SOLVE_INFINITY;
+        current.disproof = proven ? SOLVE_INFINITY : 0;
+        storeNumbers( search, key, turnsLeft, current );
+        return;
+
+    }
+
+    vector< unsigned long long > childKeys;
+
+    for ( board &iter : children )
+        childKeys.push_back( iter.hashKey() );
+
+    while (1) {
+
+        // With the attacker to move, the proof number is the smallest of the children and the disproof number is found
+        //      from all of them; with the defender to move, the other way around
+        // Many lines transpose into the same positions, so summing the numbers of all children would count them many times
+        //      Instead, the largest number is taken with 1 added for each other unsolved child (weak proof numbers)
+        unsigned int smallest = SOLVE_INFINITY, second = SOLVE_INFINITY, largest = 0;
+        int best = 0, unsolved = 0;
+
+        for ( int i=0; i<int( children.size() ); i++ ) {
+
+            proofNumbers child = lookupNumbers( search, childKeys[i], turnsLeft-1 );
+            unsigned int minNumber = attackerTurn ? child.proof : child.disproof;
+            unsigned int allNumber = attackerTurn ? child.disproof : child.proof;
+
+            if ( minNumber < smallest ) {
+
+                second = smallest;
+                smallest = minNumber;
+                best = i;
+
+            }
+            else if ( minNumber < second )
+                second = minNumber;
+
+            if ( allNumber != 0 ) {
+
+                largest = std::max( largest, allNumber );
+                unsolved++;
+
+            }
+
+        }
+
+        unsigned int weak = ( unsolved == 0 ) ? 0 : addNumbers( largest, unsolved-1 );
+
+        current.proof = attackerTurn ? smallest : weak;
+        current.disproof = attackerTurn ? weak : smallest;
+
+        if ( current.proof >= proofLimit || current.disproof >= disproofLimit || search.exhausted )
+            break;
+
+        // The child is searched until it is no longer the smallest, or the board reaches its limits
+        // The board reaches its limit once the child has the largest number and reaches the limit less the other unsolved children
+        unsigned int childProof, childDisproof;
+
+        if ( attackerTurn ) {
+
+            childProof = min( proofLimit, addNumbers( second, 1 ) );
+            childDisproof = disproofLimit - current.disproof + largest;
+
+        }
+        else {
+
+            childProof = proofLimit - current.proof + largest;
+            childDisproof = min( disproofLimit, addNumbers( second, 1 ) );
+
+        }
+
+        children[ best ].proveNode( search, turnsLeft-1, childProof, childDisproof );
+
+    }
+
+    storeNumbers( search, key, turnsLeft, current );
+
+}
+
+
+// Plays each available turn on a copy of the board
+void board::expandNode( vector< board > &children ) {
+
+    turnList turns;
+    getCurTurnActions( *this, turn(), turns );
+
+    for ( turn &iter : turns ) {
+
+        children.push_back( *this );
+        children.back().applyTurn( iter );
+
+    }
+
+}
+
+
+// Counts the positions in the proof tree below the board, or its disproof tree if proof is false
+//      A proof tree holds one proven turn for each attacker position and every turn for each defender position
+//      A disproof tree holds every turn for each attacker position and one disproven turn for each defender position
+// Positions reached more than once are counted once
+long board::proofTreeSize( proofSearch &search, bool proof ) {
+
+    unordered_set< unsigned long long > counted;
+    vector< std::pair< board, int > > stack( 1, std::make_pair( *this, search.horizon ) );
+
+    while ( !stack.empty() ) {
+
+        board curBoard = stack.back().first;
+        int turnsLeft = stack.back().second;
+        stack.pop_back();
+
+        if ( !counted.insert( curBoard.hashKey() ).second || turnsLeft == 0 )
+            continue;
+
+        vector< board > children;
+        curBoard.expandNode( children );
+
+        // Turns needed to show the result, either all of them or the first that shows it
+        bool attackerTurn = ( curBoard.redTurn ? COLOR_RED_VAL : COLOR_WHITE_VAL ) == search.attacker;
+        bool allTurns = ( attackerTurn != proof );
+
+        for ( board &iter : children ) {
+
+            proofNumbers child = lookupNumbers( search, iter.hashKey(), turnsLeft-1 );
+
+            if ( ( proof ? child.proof : child.disproof ) != 0 )
+                continue;
+
+            stack.push_back( std::make_pair( iter, turnsLeft-1 ) );
+
+            if ( !allTurns )
+                break;
+
+        }
+
+    }
+
+    return counted.size();
+
+}
+
+
+// Proves the result of a board file with the given player to move, and prints it
+void board::solveFile( const string &fileName, bool redToMove, long nodeBudget ) {
+
+    board position;
+    position.loadBoardFile( fileName, redToMove );
+
+    std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+    solveResult solved = position.solve( nodeBudget );
+    std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+
+    string player = redToMove ? "Red" : "White";
+    string opponent = redToMove ? "White" : "Red";
+
+    switch ( solved.result ) {
+
+    case SOLVE_WIN:
+
+        cout << player << " wins with " << turnName( solved.bestTurn ) << "\n";
+        break;
+
+    case SOLVE_LOSS:
+
+        cout << opponent << " wins" << "\n";
+        break;
+
+    case SOLVE_DRAW:
+
+        cout << "Draw: neither player can force a win" << "\n";
+        break;
+
+    default:
+
+        cout << "Unknown: the search gave up" << "\n";
+        break;
+
+    }
+
+    if ( solved.result != SOLVE_UNKNOWN )
+        cout << "Proof size: " << solved.proofSize << " positions" << "\n";
+
+    cout << "Positions searched: " << solved.nodes << "\n"
+         << "Time: " << elapsed.count() << " seconds" << endl;
+
+}
+
+
+// Returns the numbers of a position with a number of turns left
+// Positions not searched yet start at 1
+proofNumbers lookupNumbers( const proofSearch &search, unsigned long long key, int turnsLeft ) {
+
+    proofNumbers numbers;
+    auto found = search.solved.find( key );
+
+    if ( found != search.solved.end() ) {
+
+        if ( found->second.provenTurns >= 0 && found->second.provenTurns <= turnsLeft ) {
+
+            numbers.proof = 0;
+            numbers.disproof = SOLVE_INFINITY;
+            return numbers;
+
+        }
+
+        if ( found->second.disprovenTurns >= turnsLeft ) {
+
+            numbers.proof = SOLVE_INFINITY;
+            numbers.disproof = 0;
+            return numbers;
+
+        }
+
+    }
+
+    auto unsolved = search.numbers.find( searchKey( key, turnsLeft ) );
+
+    if ( unsolved != search.numbers.end() )
+        numbers = unsolved->second;
+
+    return numbers;
+
+}
+
+
+// Stores the numbers of a position with a number of turns left
+// Solved positions keep the widest range of turns left they hold for, and their unsolved numbers are dropped
+void storeNumbers( proofSearch &search, unsigned long long key, int turnsLeft, const proofNumbers &numbers ) {
+
+    if ( numbers.proof != 0 && numbers.disproof != 0 ) {
+
+        search.numbers[ searchKey( key, turnsLeft ) ] = numbers;
+        return;
+
+    }
+
+    solvedEntry &entry = search.solved[ key ];
+
+    if ( numbers.proof == 0 && ( entry.provenTurns < 0 || turnsLeft < entry.provenTurns ) )
+        entry.provenTurns = turnsLeft;
+    else if ( numbers.disproof == 0 )
+        entry.disprovenTurns = std::max( entry.disprovenTurns, turnsLeft );
+
+    search.numbers.erase( searchKey( key, turnsLeft ) );
+
+}
+
+
+// Returns the key of a position with a number of turns left, for the numbers of an unsolved search
+unsigned long long searchKey( unsigned long long key, int turnsLeft ) {
+
+    unsigned long long state = turnsLeft;
+
+    return key ^ splitMix( state );
+
+}
+
+
+// Adds proof or disproof numbers, keeping solved positions at infinity
+// Sums of unsolved positions stay below infinity
+unsigned int addNumbers( unsigned int a, unsigned int b ) {
+
+    if ( a == SOLVE_INFINITY || b == SOLVE_INFINITY )
+        return SOLVE_INFINITY;
+
+    return min( a + b, SOLVE_INFINITY - 1 );
+
+}
@@ -0,0 +1,444 @@
+#include "checkers.h"
+#include <cstring>
+#include <fstream>
+
+using std::memory_order_relaxed;
+using std::ofstream;
+
+using namespace checkersVals;
+
+transpositionTable board::table;
+evalCache board::evals;
+string board::snapshotFile;
+
+
+// Packs an entry and a search generation into a single word
+//      Bits 0-31: Score
+//      Bits 32-47: Move
+//      Bits 48-55: Depth
+//      Bits 56-57: Bound
+//      Bits 58-63: Generation
+unsigned long long packEntry( const tableEntry &, unsigned int );
+
+// Unpacks an entry from a word
+void unpackEntry( unsigned long long, tableEntry & );
+
+// Returns the search generation of a packed entry
+unsigned int entryGeneration( unsigned long long );
+
+// Returns the checksum of a block of 64-bit words (FNV-1a over words)
+unsigned long long checksumWords( const unsigned long long *, size_t );
+
+// Checks the header of a table or snapshot file against the expected magic and size
+bool validHeader( const tableHeader &, const char *, size_t );
+
+// Checks a slot read from a table file, given its index
+//      Empty slots are valid; other slots must hold a key belonging to the slot and an entry with a valid bound
+bool validSlot( unsigned long long, unsigned long long, int );
+
+
+///////////////////////////////////// Transposition Table /////////////////////////////////////
+
+// Constructor
+// Allocates an empty table in memory
+transpositionTable::transpositionTable() {
+
+    memory.reset( new slot[ TABLE_ENTRIES ] );
+    slots = memory.get();
+    generation = 0;
+    clear();
+
+}
+
+
+// Destructor
+// Flushes a mapped table to its file
+transpositionTable::~transpositionTable() {
+
+    sync();
+
+}
+
+
+// Finds the entry for a key
+// If the key is not in the table, returns false
+bool transpositionTable::probe( unsigned long long key, tableEntry &entry ) const {
+
+    const slot &curSlot = slots[ key & ( TABLE_ENTRIES - 1 ) ];
+    unsigned long long data = curSlot.data.load( memory_order_relaxed );
+
+    // Empty slots and slots holding other positions fail the check
+    if ( data == 0 || ( curSlot.check.load( memory_order_relaxed ) ^ data ) != key )
+        return false;
+
+    unpackEntry( data, entry );
+    return true;
+
+}
+
+
+// Stores an entry
+// Replaces the current entry of the slot if it is for the same position, from an older search or not as deep
+void transpositionTable::store( unsigned long long key, const tableEntry &entry ) {
+
+    slot &curSlot = slots[ key & ( TABLE_ENTRIES - 1 ) ];
+    unsigned long long oldData = curSlot.data.load( memory_order_relaxed );
+    unsigned int curGeneration = generation.load( memory_order_relaxed );
+
+    if ( oldData != 0 && ( curSlot.check.load( memory_order_relaxed ) ^ oldData ) != key
+         && entryGeneration( oldData ) == curGeneration ) {
+
+        tableEntry oldEntry;
+        unpackEntry( oldData, oldEntry );
+
+        if ( oldEntry.depth > entry.depth )
+            return;
+
+    }
+
+    unsigned long long data = packEntry( entry, curGeneration );
+
+    curSlot.check.store( key ^ data, memory_order_relaxed );
+    curSlot.data.store( data, memory_order_relaxed );
+
+}
+
+
+// Starts a new search, so entries from older searches are replaced first
+void transpositionTable::newSearch() {
+
+    generation = ( generation + 1 ) % 64;
+
+}
+
+
+// Removes all entries
+void transpositionTable::clear() {
+
+    for ( int i=0; i<TABLE_ENTRIES; i++ ) {
+
+        slots[i].check.store( 0, memory_order_relaxed );
+        slots[i].data.store( 0, memory_order_relaxed );
+
+    }
+
+}
+
+
+// Moves the table into a memory-mapped file
+// If the header of the file is current, its entries are kept, each checked on its own; otherwise the entries in memory are moved into it
+//      Every store leaves the file consistent apart from the slot being written, so a table left by a killed process is still used
+// If the file cannot be mapped, returns false and the table stays in memory
+bool transpositionTable::mapFile( const string &fileName ) {
+
+    size_t fileSize = sizeof( tableHeader ) + size_t( TABLE_ENTRIES ) * sizeof( slot );
+
+    if ( !file.create( fileName, fileSize ) )
+        return false;
+
+    tableHeader *header = reinterpret_cast< tableHeader * >( file.writableData() );
+    slot *fileSlots = reinterpret_cast< slot * >( file.writableData() + sizeof( tableHeader ) );
+
+    if ( validHeader( *header, TABLE_MAGIC, TABLE_ENTRIES ) ) {
+
+        // Clears slots that fail their check, such as a slot torn by a store cut short when the process was killed
+        for ( int i=0; i<TABLE_ENTRIES; i++ ) {
+
+            unsigned long long check = fileSlots[i].check.load( memory_order_relaxed );
+            unsigned long long data = fileSlots[i].data.load( memory_order_relaxed );
+
+            if ( !validSlot( check, data, i ) ) {
+
+                fileSlots[i].check.store( 0, memory_order_relaxed );
+                fileSlots[i].data.store( 0, memory_order_relaxed );
+
+            }
+
+        }
+
+    }
+    else {
+
+        memset( header, 0, sizeof( tableHeader ) );
+        memcpy( header->magic, TABLE_MAGIC, sizeof( header->magic ) );
+        header->version = TABLE_VERSION;
+        header->numEntries = TABLE_ENTRIES;
+
+        for ( int i=0; i<TABLE_ENTRIES; i++ ) {
+
+            fileSlots[i].check.store( slots[i].check.load( memory_order_relaxed ), memory_order_relaxed );
+            fileSlots[i].data.store( slots[i].data.load( memory_order_relaxed ), memory_order_relaxed );
+
+        }
+
+    }
+
+    slots = fileSlots;
+
+    memory.reset();
+
+    return true;
+
+}
+
+
+// Flushes a mapped table to its file
+// Entries reach the file even if the process is killed before this is called, so it only hurries the writes
+void transpositionTable::sync() {
+
+    if ( file.writableData() == nullptr )
+        return;
+
+    file.flush();
+
+}
+
+
+// Adds the entries of a snapshot file to the table
+// If the file is missing, stale or corrupt, returns false
+bool transpositionTable::loadSnapshot( const string &fileName ) {
+
+    mappedFile snapshot;
+
+    if ( !snapshot.open( fileName ) || snapshot.size() < sizeof( tableHeader ) )
+        return false;
+
+    const tableHeader *header = reinterpret_cast< const tableHeader * >( snapshot.data() );
+    const unsigned long long *records = reinterpret_cast< const unsigned long long * >( snapshot.data() + sizeof( tableHeader ) );
+
+    // Each entry is stored as its key and its packed data
+    if ( !validHeader( *header, TABLE_SNAPSHOT_MAGIC, header->numEntries )
+         || snapshot.size() != sizeof( tableHeader ) + size_t( header->numEntries ) * 2 * sizeof( unsigned long long )
+         || header->checksum != checksumWords( records, 2*size_t( header->numEntries ) ) )
+        return false;
+
+    tableEntry entry;
+
+    for ( unsigned int i=0; i<header->numEntries; i++ ) {
+
+        unpackEntry( records[ 2*i+1 ], entry );
+        store( records[ 2*i ], entry );
+
+    }
+
+    return true;
+
+}
+
+
+// Writes the entries searched to at least a depth to a snapshot file
+// If the file cannot be written, returns false
+bool transpositionTable::saveSnapshot( const string &fileName, int minDepth ) {
+
+    vector< unsigned long long > records;
+    unsigned long long data;
+    tableEntry entry;
+
+    for ( int i=0; i<TABLE_ENTRIES; i++ ) {
+
+        data = slots[i].data.load( memory_order_relaxed );
+
+        if ( data == 0 )
+            continue;
+
+        unpackEntry( data, entry );
+
+        if ( entry.depth >= minDepth ) {
+
+            records.push_back( slots[i].check.load( memory_order_relaxed ) ^ data );
+            records.push_back( data );
+
+        }
+
+    }
+
+    tableHeader header {};
+    memcpy( header.magic, TABLE_SNAPSHOT_MAGIC, sizeof( header.magic ) );
+    header.version = TABLE_VERSION;
+    header.numEntries = records.size() / 2;
+    header.checksum = checksumWords( records.data(), records.size() );
+
+    ofstream output( fileName, std::ios::binary );
+    output.write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+    output.write( reinterpret_cast< const char * >( records.data() ), records.size() * sizeof( unsigned long long ) );
+
+    return bool( output );
+
+}
+
+
+// Maps the transposition table to a file, so it is kept across runs
+bool board::mapTable( const string &fileName ) {
+
+    return table.mapFile( fileName );
+
+}
+
+
+// Loads a snapshot of the deep entries of the transposition table
+bool board::loadTable( const string &fileName ) {
+
+    return table.loadSnapshot( fileName );
+
+}
+
+
+// Saves a snapshot of the deep entries of the transposition table
+// A mapped table is also written back to its file
+bool board::saveTable( const string &fileName ) {
+
+    table.sync();
+    return table.saveSnapshot( fileName, TABLE_SNAPSHOT_DEPTH );
+
+}
+
+
+// Loads a snapshot of the table, and keeps its file name so games save the table back to it
+bool board::useSnapshot( const string &fileName ) {
+
+    snapshotFile = fileName;
+    return loadTable( fileName );
+
+}
+
+
+// Saves a snapshot of the table to the file given to useSnapshot, or to TABLE_SNAPSHOT_FILE if none was given
+bool board::saveSnapshot() {
+
+    return saveTable( snapshotFile.empty() ? TABLE_SNAPSHOT_FILE : snapshotFile );
+
+}
+
+
+///////////////////////////////////// Evaluation Cache /////////////////////////////////////
+
+// Constructor
+// Allocates an empty cache
+evalCache::evalCache() {
+
+    slots.reset( new slot[ EVAL_CACHE_ENTRIES ] );
+    clear();
+
+}
+
+
+// Finds the score for a key
+// If the key is not in the cache, returns false
+bool evalCache::probe( unsigned long long key, float &score ) const {
+
+    const slot &curSlot = slots[ key & ( EVAL_CACHE_ENTRIES - 1 ) ];
+    unsigned long long data = curSlot.data.load( memory_order_relaxed );
+
+    if ( data == 0 || ( curSlot.check.load( memory_order_relaxed ) ^ data ) != key )
+        return false;
+
+    unsigned int scoreBits = (unsigned int)( data );
+    memcpy( &score, &scoreBits, sizeof( scoreBits ) );
+
+    return true;
+
+}
+
+
+// Stores the score for a key, replacing the current entry of its slot
+void evalCache::store( unsigned long long key, float score ) {
+
+    slot &curSlot = slots[ key & ( EVAL_CACHE_ENTRIES - 1 ) ];
+    unsigned int scoreBits;
+    memcpy( &scoreBits, &score, sizeof( scoreBits ) );
+
+    unsigned long long data = (unsigned long long)( scoreBits ) | ( 1ULL << 32 );
+
+    curSlot.check.store( key ^ data, memory_order_relaxed );
+    curSlot.data.store( data, memory_order_relaxed );
+
+}
+
+
+// Removes all entries
+void evalCache::clear() {
+
+    for ( int i=0; i<EVAL_CACHE_ENTRIES; i++ ) {
+
+        slots[i].check.store( 0, memory_order_relaxed );
+        slots[i].data.store( 0, memory_order_relaxed );
+
+    }
+
+}
+
+
+// Packs an entry and a search generation into a single word
+unsigned long long packEntry( const tableEntry &entry, unsigned int generation ) {
+
+    unsigned int scoreBits;
+    memcpy( &scoreBits, &entry.score, sizeof( scoreBits ) );
+
+    return (unsigned long long)( scoreBits )
+           | (unsigned long long)( entry.move ) << 32
+           | (unsigned long long)( entry.depth & 0xFF ) << 48
+           | (unsigned long long)( entry.bound & 3 ) << 56
+           | (unsigned long long)( generation & 63 ) << 58;
+
+}
+
+
+// Unpacks an entry from a word
+void unpackEntry( unsigned long long data, tableEntry &entry ) {
+
+    unsigned int scoreBits = (unsigned int)( data );
+    memcpy( &entry.score, &scoreBits, sizeof( scoreBits ) );
+
+    entry.move = action( data >> 32 );
+    entry.depth = ( data >> 48 ) & 0xFF;
+    entry.bound = ( data >> 56 ) & 3;
+
+}
+
+
+// Returns the search generation of a packed entry
+unsigned int entryGeneration( unsigned long long data ) {
+
+    return ( data >> 58 ) & 63;
+
+}
+
+
+// Returns the checksum of a block of 64-bit words
+// Uses FNV-1a over whole words rather than bytes
+unsigned long long checksumWords( const unsigned long long *words, size_t count ) {
+
+    unsigned long long checksum = 0xCBF29CE484222325ULL;
+
+    for ( size_t i=0; i<count; i++ )
+        checksum = ( checksum ^ words[i] ) * 0x100000001B3ULL;
+
+    return checksum;
+
+}
+
+
+// Checks the header of a table or snapshot file against the expected magic and number of entries
+bool validHeader( const tableHeader &header, const char *magic, size_t numEntries ) {
+
+    return strncmp( header.magic, magic, sizeof( header.magic ) ) == 0
+           && header.version == TABLE_VERSION
+           && header.numEntries == numEntries;
+
+}
+
+
+// Checks a slot read from a table file, given its index
+// A slot torn between its two words gives a key that almost never belongs to the slot
+bool validSlot( unsigned long long check, unsigned long long data, int index ) {
+
+    if ( data == 0 )
+        return check == 0;
+
+    tableEntry entry;
+    unpackEntry( data, entry );
+
+    return ( ( check ^ data ) & ( TABLE_ENTRIES - 1 ) ) == (unsigned long long)( index )
+           && entry.bound <= transpositionTable::BOUND_UPPER;
+
+}
@@ -0,0 +1,151 @@
+#include "checkers.h"
+#include <fstream>
+#include <cstring>
+
+using std::ofstream;
+using std::atomic;
+using std::lock_guard;
+using std::mutex;
+
+using namespace checkersVals;
+
+searchTrace board::trace;
+
+// Number given to the next thread that records to the trace
+static atomic<unsigned int> nextThread( 0 );
+
+
+// Records of the current thread, waiting to be written to the trace
+// Written when full, after each search and when the thread exits
+struct traceBuffer {
+
+    vector< traceRecord > records;
+    unsigned int thread = 0;
+    searchTrace *owner = nullptr;   // Trace the records are written to
+
+    ~traceBuffer();
+
+};
+
+static thread_local traceBuffer buffer;
+
+
+///////////////////////////////////// Search Trace /////////////////////////////////////
+
+// Destructor
+// Closes the trace file
+searchTrace::~searchTrace() {
+
+    active = false;
+
+}
+
+
+// Opens the trace file and enables tracing
+// If the file cannot be opened, returns false
+bool searchTrace::start( const string &fileName ) {
+
+    output.reset( new ofstream( fileName, std::ios::binary ) );
+
+    if ( !*output ) {
+
+        output.reset();
+        return false;
+
+    }
+
+    traceHeader header {};
+    memcpy( header.magic, TRACE_MAGIC, sizeof( header.magic ) );
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof( traceRecord );
+
+    output->write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+
+    active = true;
+    return true;
+
+}
+
+
+// Adds a record to the buffer of the current thread
+void searchTrace::record( const traceRecord &curRecord ) {
+
+    // Numbers the thread on its first record
+    if ( buffer.records.capacity() == 0 ) {
+
+        buffer.records.reserve( TRACE_BUFFER_RECORDS );
+        buffer.thread = nextThread++;
+        buffer.owner = this;
+
+    }
+
+    buffer.records.push_back( curRecord );
+
+    if ( buffer.records.size() == TRACE_BUFFER_RECORDS )
+        flush();
+
+}
+
+
+// Writes the buffer of the current thread to the file
+void searchTrace::flush() {
+
+    write( buffer.thread, buffer.records.data(), buffer.records.size() );
+    buffer.records.clear();
+
+}
+
+
+// Writes a chunk of records from a thread to the file
+void searchTrace::write( unsigned int thread, const traceRecord *records, int numRecords ) {
+
+    if ( !active || numRecords == 0 )
+        return;
+
+    traceChunk chunk;
+    chunk.thread = thread;
+    chunk.numRecords = numRecords;
+
+    lock_guard< mutex > lock( outputLock );
+
+    output->write( reinterpret_cast< const char * >( &chunk ), sizeof( chunk ) );
+    output->write( reinterpret_cast< const char * >( records ), numRecords * sizeof( traceRecord ) );
+    output->flush();
+
+}
+
+
+// Destructor
+// Writes the records left when the thread exits
+traceBuffer::~traceBuffer() {
+
+    if ( owner != nullptr )
+        owner->write( thread, records.data(), records.size() );
+
+}
+
+
+// Records the nodes visited by minimax to a binary trace file
+// If the file cannot be opened, returns false
+bool board::startTrace( const string &fileName ) {
+
+    return trace.start( fileName );
+
+}
+
+
+// Records a node of the search to the trace
+// The node is identified by its depth in actions and the last action leading to it
+void board::traceNode( float alpha, float beta, float nodeScore, int flags ) {
+
+    traceRecord curRecord;
+    curRecord.alpha = alpha;
+    curRecord.beta = beta;
+    curRecord.score = nodeScore;
+    curRecord.move = moves.empty() ? 0 : moves.back();
+    curRecord.ply = (unsigned char)( moves.size() );
+    curRecord.flags = flags;
+
+    trace.record( curRecord );
+
+}
@@ -1,6 +1,175 @@
 #include "checkers.h"
+#include <iostream>
+#include <cstdlib>
 
-int main() {
+int main( int argc, char *argv[] ) {
+
+    // Options given before any other command
+    //      checkers trace <file> [<command> ...]       Records the nodes visited by minimax, for offline analysis with traceView
+    //      checkers deterministic [<command> ...]      Searches without random noise or random tie-breaks
+    //      checkers mirrortable [<command> ...]        Shares transposition table entries between mirror images
+    //      checkers usebook <file> [<command> ...]     Plays book turns from an opening book
+    //      checkers usetable <file> [<command> ...]    Starts searches from a table snapshot, and saves the table back to it after each game
+    // Files left by earlier runs are only used when given, so runs are repeatable by default
+    string bookFile, tableFile;
+
+    while ( argc > 1 ) {
+
+        if ( string( argv[1] ) == "trace" && argc > 2 ) {
+
+            if ( !board::startTrace( argv[2] ) ) {
+
+                std::cerr << "Could not open the trace file " << argv[2] << ".";
+                exit( EXIT_FAILURE );
+
+            }
+
+            // Drops the option, keeping the program name
+            argv[2] = argv[0];
+            argv += 2;
+            argc -= 2;
+
+        }
+        else if ( string( argv[1] ) == "deterministic" ) {
+
+            board::setDeterministic( true );
+
+            argv[1] = argv[0];
+            argv += 1;
+            argc -= 1;
+
+        }
+        else if ( string( argv[1] ) == "mirrortable" ) {
+
+            board::setMirrorTable( true );
+
+            argv[1] = argv[0];
+            argv += 1;
+            argc -= 1;
+
+        }
+        else if ( ( string( argv[1] ) == "usebook" || string( argv[1] ) == "usetable" ) && argc > 2 ) {
+
+            ( string( argv[1] ) == "usebook" ? bookFile : tableFile ) = argv[2];
+
+            argv[2] = argv[0];
+            argv += 2;
+            argc -= 2;
+
+        }
+        else
+            break;
+
+    }
+
+    // Opening book built from the early game tree
+    //      checkers book <turns> <seconds per position> [<file>]
+    if ( argc > 1 && string( argv[1] ) == "book" ) {
+
+        if ( argc != 4 && argc != 5 ) {
+
+            std::cerr << "Usage: " << argv[0] << " book <turns> <seconds per position> [<file>]";
+            exit( EXIT_FAILURE );
+
+        }
+
+        board::buildBook( atoi( argv[2] ), atof( argv[3] ), ( argc == 5 ) ? argv[4] : BOOK_FILE );
+        return 0;
+
+    }
+
+    // Proof-number search of a board file, proving a win, loss or draw for the player to move
+    //      checkers solve <board file> <r|w> [<positions>]
+    if ( argc > 1 && string( argv[1] ) == "solve" ) {
+
+        if ( ( argc != 4 && argc != 5 ) || ( string( argv[3] ) != "r" && string( argv[3] ) != "w" ) ) {
+
+            std::cerr << "Usage: " << argv[0] << " solve <board file> <r|w> [<positions>]";
+            exit( EXIT_FAILURE );
+
+        }
+
+        board::solveFile( argv[2], string( argv[3] ) == "r", ( argc == 5 ) ? atol( argv[4] ) : SOLVE_NODES );
+        return 0;
+
+    }
+
+    // Matches compare the engines alone, so neither engine is given a book or earlier table entries
+    if ( argc > 1 && string( argv[1] ) == "match" && ( !bookFile.empty() || !tableFile.empty() ) ) {
+
+        std::cerr << "The usebook and usetable options cannot be used with match.";
+        exit( EXIT_FAILURE );
+
+    }
+
+    if ( !bookFile.empty() && !board::loadBook( bookFile ) )
+        std::cerr << "Could not open the opening book " << bookFile << ". Every position is searched." << std::endl;
+
+    if ( !tableFile.empty() && !board::useSnapshot( tableFile ) )
+        std::cerr << "Could not load the table snapshot " << tableFile << ". The table starts empty." << std::endl;
+
+    // Best lines of a board file, each with an exact score (multi-PV)
+    //      checkers multipv <board file> <r|w> <seconds> <lines>
+    if ( argc > 1 && string( argv[1] ) == "multipv" ) {
+
+        if ( argc != 6 || ( string( argv[3] ) != "r" && string( argv[3] ) != "w" ) || atof( argv[4] ) <= 0 || atoi( argv[5] ) <= 0 ) {
+
+            std::cerr << "Usage: " << argv[0] << " multipv <board file> <r|w> <seconds> <lines>";
+            exit( EXIT_FAILURE );
+
+        }
+
+        board::multiPVFile( argv[2], string( argv[3] ) == "r", atof( argv[4] ), atoi( argv[5] ) );
+        return 0;
+
+    }
+
+    // Headless match between two engines
+    //      checkers match <engine A> <seconds A> <engine B> <seconds B> <games> [<elo0> <elo1>]
+    //      The number of games must be even, since each opening is played with both colors
+    //      Engines: 0 = Minimax, 1 = MCTS (random rollouts), 2 = MCTS (heuristic rollouts)
+    if ( argc > 1 && string( argv[1] ) == "match" ) {
+
+        if ( argc != 7 && argc != 9 ) {
+
+            std::cerr << "Usage: " << argv[0] << " match <engine A> <seconds A> <engine B> <seconds B> <games> [<elo0> <elo1>]";
+            exit( EXIT_FAILURE );
+
+        }
+
+        float elo0 = 0, elo1 = 10;
+
+        if ( argc == 9 ) {
+
+            elo0 = atof( argv[7] );
+            elo1 = atof( argv[8] );
+
+        }
+
+        board::playMatch( atoi( argv[2] ), atof( argv[3] ), atoi( argv[4] ), atof( argv[5] ), atoi( argv[6] ), elo0, elo1 );
+        return 0;
+
+    }
+
+    // Analysis daemon serving requests on a localhost port
+    // The transposition table can be kept in a file, so it is warm after a restart
+    //      checkers daemon [<port>] [<table file>]
+    if ( argc > 1 && string( argv[1] ) == "daemon" ) {
+
+        if ( argc < 2 || argc > 4 ) {
+
+            std::cerr << "Usage: " << argv[0] << " daemon [<port>] [<table file>]";
+            exit( EXIT_FAILURE );
+
+        }
+
+        if ( argc == 4 && !board::mapTable( argv[3] ) )
+            std::cerr << "Could not map the table to " << argv[3] << ". The table is kept in memory." << std::endl;
+
+        board::runDaemon( ( argc >= 3 ) ? atoi( argv[2] ) : DAEMON_PORT );
+        return 0;
+
+    }
 
     board newBoard;
     //newBoard.specialBoard();
@@ -0,0 +1,225 @@
+#include "checkers.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <map>
+#include <set>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::ifstream;
+using std::map;
+using std::set;
+using std::setw;
+
+using namespace checkersVals;
+
+#define FOLDED_PLIES 4  // Default number of plies kept in each stack of the folded view
+
+
+// Node waiting for its parent, whose record comes later
+struct pendingNode {
+
+    action move;
+    map< string, long > stacks;     // Nodes below the node by their path from it, "" for the node itself
+
+};
+
+// Statistics for the nodes at a ply
+struct plyStats {
+
+    long nodes = 0;
+    long leaves = 0;
+    long cutoffs = 0;
+    long tableHits = 0;
+    long tableCutoffs = 0;
+    long timeouts = 0;
+
+};
+
+// Returns the name of a square, e.g. b1
+string squareName( int );
+
+// Returns the name of an action, e.g. c3-d4
+string actionName( action );
+
+// Adds a record to the tree of pending nodes of its thread
+// Once the root of a search is reached, its stacks are added to the folded view
+void addToTree( const traceRecord &, vector< vector< pendingNode > > &, int, map< string, long > & );
+
+
+// Converts a trace written by checkers trace into a readable view
+//      traceView <trace file> [summary]            Nodes, cutoffs and table use by ply
+//      traceView <trace file> folded [<plies>]     Folded stacks of the search tree, for flame graph tools
+int main( int argc, char *argv[] ) {
+
+    if ( argc < 2 || argc > 4 ) {
+
+        cerr << "Usage: " << argv[0] << " <trace file> [summary | folded [<plies>]]" << endl;
+        exit( EXIT_FAILURE );
+
+    }
+
+    string mode = ( argc >= 3 ) ? argv[2] : "summary";
+    int maxPly = ( argc == 4 ) ? atoi( argv[3] ) : FOLDED_PLIES;
+
+    if ( mode != "summary" && mode != "folded" ) {
+
+        cerr << "Unknown view " << mode << endl;
+        exit( EXIT_FAILURE );
+
+    }
+
+    ifstream input( argv[1], std::ios::binary );
+    traceHeader header;
+
+    if ( !input.read( reinterpret_cast< char * >( &header ), sizeof( header ) )
+         || strncmp( header.magic, TRACE_MAGIC, sizeof( header.magic ) ) != 0
+         || header.version != TRACE_VERSION || header.recordSize != sizeof( traceRecord ) ) {
+
+        cerr << "Error: " << argv[1] << " is not a trace file from this version" << endl;
+        exit( EXIT_FAILURE );
+
+    }
+
+    // Records of each thread are in post-order, so each thread rebuilds its own tree
+    map< unsigned int, vector< vector< pendingNode > > > trees;
+    map< string, long > folded;
+    set< unsigned int > threads;
+    vector< plyStats > stats;
+    vector< traceRecord > records;
+    traceChunk chunk;
+    long numRecords = 0, numRoots = 0;
+
+    while ( input.read( reinterpret_cast< char * >( &chunk ), sizeof( chunk ) ) ) {
+
+        records.resize( chunk.numRecords );
+        threads.insert( chunk.thread );
+
+        if ( !input.read( reinterpret_cast< char * >( records.data() ), chunk.numRecords * sizeof( traceRecord ) ) ) {
+
+            cerr << "Warning: trace ends in the middle of a chunk" << endl;
+            break;
+
+        }
+
+        for ( traceRecord &iter : records ) {
+
+            if ( int( stats.size() ) <= iter.ply )
+                stats.resize( iter.ply+1 );
+
+            plyStats &curStats = stats[ iter.ply ];
+            curStats.nodes++;
+            curStats.leaves += ( iter.flags & searchTrace::FLAG_LEAF ) != 0;
+            curStats.cutoffs += ( iter.flags & searchTrace::FLAG_CUTOFF ) != 0;
+            curStats.tableHits += ( iter.flags & searchTrace::FLAG_TABLE_HIT ) != 0;
+            curStats.tableCutoffs += ( iter.flags & searchTrace::FLAG_TABLE_CUTOFF ) != 0;
+            curStats.timeouts += ( iter.flags & searchTrace::FLAG_TIMEOUT ) != 0;
+
+            numRecords++;
+            numRoots += ( iter.ply == 0 );
+
+            if ( mode == "folded" )
+                addToTree( iter, trees[ chunk.thread ], maxPly, folded );
+
+        }
+
+    }
+
+    ////////// Folded View //////////
+    // One line per path with the number of nodes at the end of it, e.g. root;c3-d4;f6-e5 120
+    if ( mode == "folded" ) {
+
+        for ( auto &iter : folded )
+            cout << iter.first << " " << iter.second << "\n";
+
+        return 0;
+
+    }
+
+    ////////// Summary //////////
+    cout << "Records: " << numRecords << "\n"
+         << "Threads: " << threads.size() << "\n"
+         << "Searches (roots): " << numRoots << "\n" << "\n";
+
+    cout << setw(5) << "Ply" << setw(12) << "Nodes" << setw(12) << "Leaves" << setw(12) << "Cutoffs"
+         << setw(12) << "TT Hits" << setw(12) << "TT Cutoffs" << setw(12) << "Timeouts" << "\n";
+
+    for ( int ply=0; ply<int( stats.size() ); ply++ ) {
+
+        cout << setw(5) << ply << setw(12) << stats[ ply ].nodes << setw(12) << stats[ ply ].leaves
+             << setw(12) << stats[ ply ].cutoffs << setw(12) << stats[ ply ].tableHits
+             << setw(12) << stats[ ply ].tableCutoffs << setw(12) << stats[ ply ].timeouts << "\n";
+
+    }
+
+    cout << endl;
+
+    return 0;
+
+}
+
+
+// Adds a record to the tree of pending nodes of its thread
+// The children of a node are the pending nodes one ply deeper, since they were recorded before it
+// Nodes deeper than maxPly are merged into their ancestor at maxPly
+void addToTree( const traceRecord &curRecord, vector< vector< pendingNode > > &pending, int maxPly, map< string, long > &folded ) {
+
+    int ply = curRecord.ply;
+
+    if ( int( pending.size() ) <= ply+1 )
+        pending.resize( ply+2 );
+
+    pendingNode node;
+    node.move = curRecord.move;
+    node.stacks[ "" ] = 1;
+
+    for ( pendingNode &child : pending[ ply+1 ] ) {
+
+        for ( auto &iter : child.stacks ) {
+
+            if ( ply >= maxPly )
+                node.stacks[ "" ] += iter.second;
+            else if ( iter.first.empty() )
+                node.stacks[ actionName( child.move ) ] += iter.second;
+            else
+                node.stacks[ actionName( child.move ) + ";" + iter.first ] += iter.second;
+
+        }
+
+    }
+
+    pending[ ply+1 ].clear();
+
+    // The root completes a search
+    if ( ply == 0 ) {
+
+        for ( auto &iter : node.stacks )
+            folded[ iter.first.empty() ? "root" : "root;" + iter.first ] += iter.second;
+
+        return;
+
+    }
+
+    pending[ ply ].push_back( node );
+
+}
+
+
+// Returns the name of a square, e.g. b1
+string squareName( int square ) {
+
+    return string( 1, char( SQUARES.row[ square ]+97 ) ) + std::to_string( SQUARES.col[ square ]+1 );
+
+}
+
+
+// Returns the name of an action, e.g. c3-d4
+string actionName( action curAction ) {
+
+    return squareName( actionStart( curAction ) ) + "-" + squareName( actionDestination( curAction ) );
+
+}
@@ -0,0 +1,150 @@
+#include "neuralNetwork.h"
+#include <cstdlib>
+#include <algorithm>
+
+
+using std::cerr;
+
+
+template <class T>
+void checkValidStream( T &, string );
+template <class T>
+bool storeInputs( const vector<double> &, char * );
+
+
+// Converts a text dataset into the binary dataset format read by loadData
+// Examples are converted one at a time, so the text file does not need to fit in memory
+int main() {
+
+    string inFile, outFile;
+    int featureType;
+
+    cout << "Enter the name of the text dataset: ";
+    cin >> inFile;
+    ifstream input( inFile );
+    checkValidStream( input, inFile );
+
+    cout << "Enter the name of the binary dataset: ";
+    cin >> outFile;
+    ofstream output( outFile, std::ios::binary );
+    checkValidStream( output, outFile );
+
+    cout << "Enter 0 to store inputs as float64, 1 for float32, or 2 for uint8: ";
+    cin >> featureType;
+
+    if ( featureType < dataVals::FEATURES_FLOAT64 || featureType > dataVals::FEATURES_UINT8 ) {
+
+        cerr << "Error: Unknown input type " << featureType << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    int numEx, numIn, numOut;
+    input >> numEx >> numIn >> numOut;
+
+    if ( !input || numEx < 0 || numIn <= 0 || numOut <= 0 ) {
+
+        cerr << "Error: Could not read the size of " << inFile << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    // Writes the header, padded with zeros
+    vector<char> header( dataVals::DATA_HEADER_BYTES, 0 );
+    const int32_t sizes[4] = { numEx, numIn, numOut, featureType };
+
+    std::copy( dataVals::DATA_MAGIC, dataVals::DATA_MAGIC + dataVals::DATA_MAGIC_BYTES, header.begin() );
+    std::copy( reinterpret_cast< const char * >( sizes ), reinterpret_cast< const char * >( sizes ) + sizeof( sizes ),
+               header.begin() + dataVals::DATA_MAGIC_BYTES );
+    output.write( header.data(), header.size() );
+
+    // Writes one record per example, reusing the buffer so padding stays zero
+    const recordLayout layout( numIn, numOut, featureType );
+    vector<char> record( layout.recordBytes, 0 );
+    vector<double> inputs( numIn );
+    int *outputs = reinterpret_cast< int * >( record.data() + layout.inputBytes );
+    long inexact = 0;
+
+    for ( int i=0; i<numEx; i++ ) {
+
+        for ( int j=0; j<numIn; j++ )
+            input >> inputs[j];
+
+        for ( int j=0; j<numOut; j++ )
+            input >> outputs[j];
+
+        if ( !input ) {
+
+            cerr << "Error: " << inFile << " has fewer examples than its header! (" << i << " of " << numEx << ")" << "\n";
+            exit( EXIT_FAILURE );
+
+        }
+
+        bool exact;
+
+        if ( featureType == dataVals::FEATURES_FLOAT64 )
+            exact = storeInputs<double>( inputs, record.data() );
+        else if ( featureType == dataVals::FEATURES_FLOAT32 )
+            exact = storeInputs<float>( inputs, record.data() );
+        else
+            exact = storeInputs<unsigned char>( inputs, record.data() );
+
+        if ( !exact )
+            inexact++;
+
+        output.write( record.data(), record.size() );
+
+    }
+
+    if ( inexact > 0 )
+        cerr << "Warning: " << inexact << " examples have inputs that could not be stored exactly" << "\n";
+
+    input.close();
+    output.close();
+
+    return 0;
+
+}
+
+
+template <class T>
+void checkValidStream( T &stream, string fileName ) {
+
+    if ( !stream ) {
+
+        cerr << "Error: could not open " << fileName << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+}
+
+
+// Stores the inputs of an example at the start of its record, returning false if any value changed
+// Float64 inputs are stored as a row of the dataset matrix, starting with the fixed input of -1
+template <class T>
+bool storeInputs( const vector<double> &inputs, char *record ) {
+
+    T *values = reinterpret_cast< T * >( record );
+    bool exact = true;
+
+    if ( sizeof( T ) == sizeof( double ) )
+        *values++ = -1;
+
+    for ( double value : inputs ) {
+
+        // Clamps to the range of unsigned char before converting, since out of range conversions are undefined
+        double stored = value;
+
+        if ( sizeof( T ) == sizeof( unsigned char ) )
+            stored = std::min( std::max( value, 0.0 ), 255.0 );
+
+        *values = T( stored );
+        exact = exact && double( *values ) == value;
+        values++;
+
+    }
+
+    return exact;
+
+}
@@ -0,0 +1,180 @@
+#include "neuralNetwork.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+// Takes over the mapping of another file
+mappedFile::mappedFile( mappedFile &&other ) : start( other.start ), length( other.length ) {
+
+    other.start = nullptr;
+    other.length = 0;
+
+}
+
+
+mappedFile &mappedFile::operator=( mappedFile &&other ) {
+
+    if ( this != &other ) {
+
+        close();
+
+        start = other.start;
+        length = other.length;
+        other.start = nullptr;
+        other.length = 0;
+
+    }
+
+    return *this;
+
+}
+
+
+#ifdef _WIN32
+
+// Maps a file, returning false if it could not be opened or mapped
+bool mappedFile::open( string fileName ) {
+
+    close();
+
+    HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+
+    if ( file == INVALID_HANDLE_VALUE )
+        return false;
+
+    LARGE_INTEGER fileSize;
+
+    if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 ) {
+
+        CloseHandle( file );
+        return false;
+
+    }
+
+    // The view keeps the file open, so the handles can be closed once it is mapped
+    HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr );
+    CloseHandle( file );
+
+    if ( mapping == nullptr )
+        return false;
+
+    void *view = MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+    CloseHandle( mapping );
+
+    if ( view == nullptr )
+        return false;
+
+    start = static_cast< char * >( view );
+    length = fileSize.QuadPart;
+
+    return true;
+
+}
+
+
+// Unmaps the file
+void mappedFile::close() {
+
+    if ( start != nullptr )
+        UnmapViewOfFile( start );
+
+    start = nullptr;
+    length = 0;
+
+}
+
+#else
+
+// Maps a file, returning false if it could not be opened or mapped
+bool mappedFile::open( string fileName ) {
+
+    close();
+
+    int file = ::open( fileName.c_str(), O_RDONLY );
+
+    if ( file < 0 )
+        return false;
+
+    struct stat fileInfo;
+
+    if ( fstat( file, &fileInfo ) != 0 || fileInfo.st_size == 0 ) {
+
+        ::close( file );
+        return false;
+
+    }
+
+    // The mapping keeps the file open, so the descriptor can be closed once it is mapped
+    void *view = mmap( nullptr, fileInfo.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0 );
+    ::close( file );
+
+    if ( view == MAP_FAILED )
+        return false;
+
+    start = static_cast< char * >( view );
+    length = fileInfo.st_size;
+
+    return true;
+
+}
+
+
+// Unmaps the file
+void mappedFile::close() {
+
+    if ( start != nullptr )
+        munmap( start, length );
+
+    start = nullptr;
+    length = 0;
+
+}
+
+#endif
+
+
+// Computes the sizes of the inputs and of the whole record of each example
+recordLayout::recordLayout( int numIn, int numOut, int featureType ) {
+
+    const size_t align = matrixVals::MATRIX_ALIGN;
+
+    if ( featureType == dataVals::FEATURES_FLOAT64 )
+        inputBytes = matrix< double >::strideFor( numIn+1 ) * sizeof( double );
+    else if ( featureType == dataVals::FEATURES_FLOAT32 )
+        inputBytes = ( numIn * sizeof( float ) + align - 1 ) / align * align;
+    else
+        inputBytes = ( numIn * sizeof( unsigned char ) + align - 1 ) / align * align;
+
+    recordBytes = inputBytes + matrix< int >::strideFor( numOut ) * sizeof( int );
+
+}
+
+
+// Returns a checksum of a block of bytes, for detecting damaged files
+// Uses FNV-1a over 64-bit words, followed by any remaining bytes
+uint64_t checksum( const char *bytes, size_t length, uint64_t hash ) {
+
+    const uint64_t prime = 1099511628211ULL;
+    size_t i = 0;
+
+    for ( ; i+8<=length; i+=8 ) {
+
+        uint64_t word;
+        std::copy( bytes+i, bytes+i+8, reinterpret_cast< char * >( &word ) );
+        hash = ( hash ^ word ) * prime;
+
+    }
+
+    for ( ; i<length; i++ )
+        hash = ( hash ^ static_cast< unsigned char >( bytes[i] ) ) * prime;
+
+    return hash;
+
+}
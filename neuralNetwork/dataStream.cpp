@@ -0,0 +1,298 @@
+#include "neuralNetwork.h"
+#include <algorithm>
+#include <cctype>
+
+using std::unique_lock;
+using std::lock_guard;
+using std::mutex;
+
+
+// Opens a dataset and starts the background thread
+// Chunks are sized so that the two in memory, the one in use and the one being read, fit in the budget
+dataStream::dataStream( string fileName, size_t budget ) : fileName( fileName ), input( fileName, std::ios::binary ) {
+
+    if ( !input ) {
+
+        std::cerr << "Error: Could not open " << fileName << "!" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    char magic[ dataVals::DATA_MAGIC_BYTES ];
+    input.read( magic, dataVals::DATA_MAGIC_BYTES );
+
+    binary = input && std::equal( magic, magic + dataVals::DATA_MAGIC_BYTES, dataVals::DATA_MAGIC );
+
+    if ( binary ) {
+
+        int32_t header[4];
+        input.read( reinterpret_cast< char * >( header ), sizeof( header ) );
+
+        numEx = header[0];
+        numIn = header[1];
+        numOut = header[2];
+        featureType = header[3];
+
+        if ( !input || featureType < dataVals::FEATURES_FLOAT64 || featureType > dataVals::FEATURES_UINT8 ) {
+
+            std::cerr << "Error: Invalid header in binary dataset! (" << fileName << ")" << "\n";
+            exit( EXIT_FAILURE );
+
+        }
+
+    }
+    else {
+
+        input.clear();
+        input.seekg( 0 );
+        input >> numEx >> numIn >> numOut;
+
+    }
+
+    if ( !input || numEx <= 0 || numIn <= 0 || numOut <= 0 ) {
+
+        std::cerr << "Error: Could not read the size of " << fileName << "!" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    // Sizes the chunks from the memory used by each example
+    size_t exampleBytes = matrix< double >::strideFor( numIn+1 ) * sizeof( double ) + matrix< int >::strideFor( numOut ) * sizeof( int );
+
+    chunkRows = std::max( size_t( 1 ), std::min( budget / ( 2 * exampleBytes ), size_t( numEx ) ) );
+    numChunks = ( numEx + chunkRows - 1 ) / chunkRows;
+
+    if ( binary ) {
+
+        const recordLayout layout( numIn, numOut, featureType );
+
+        for ( int chunk=0; chunk<numChunks; chunk++ )
+            chunkStarts.push_back( dataVals::DATA_HEADER_BYTES + std::streamoff( chunk ) * chunkRows * layout.recordBytes );
+
+        input.seekg( 0, std::ios::end );
+
+        if ( input.tellg() < std::streamoff( dataVals::DATA_HEADER_BYTES + size_t( numEx ) * layout.recordBytes ) ) {
+
+            std::cerr << "Error: Binary dataset is shorter than its number of examples! (" << fileName << ")" << "\n";
+            exit( EXIT_FAILURE );
+
+        }
+
+    }
+    else
+        indexText( input.tellg() );
+
+    nextInputs = matrix< double >( chunkRows, numIn+1 );
+    nextOutputs = matrix< int >( chunkRows, numOut );
+
+    pendingChunk = -1;
+    filledRows = -1;
+    stopping = false;
+
+    prefetcher = std::thread( &dataStream::prefetchLoop, this );
+
+}
+
+
+// Stops and joins the background thread
+dataStream::~dataStream() {
+
+    {
+        lock_guard< mutex > guard( lock );
+        stopping = true;
+    }
+
+    requested.notify_one();
+    prefetcher.join();
+
+}
+
+
+// Starts reading a chunk in the background
+// The chunk from the previous request must have been taken by next first
+void dataStream::request( int chunk ) {
+
+    {
+        lock_guard< mutex > guard( lock );
+        pendingChunk = chunk;
+        filledRows = -1;
+    }
+
+    requested.notify_one();
+
+}
+
+
+// Waits for the requested chunk and swaps it into the matrices, returning its number of examples
+int dataStream::next( matrix< double > &inputs, matrix< int > &outputs ) {
+
+    unique_lock< mutex > guard( lock );
+    finished.wait( guard, [this]() { return filledRows >= 0; } );
+
+    // The matrices given must have been made by an earlier call, or be empty, so they can hold the next chunk once swapped
+    if ( inputs.rows() != chunkRows ) {
+
+        inputs = matrix< double >( chunkRows, numIn+1 );
+        outputs = matrix< int >( chunkRows, numOut );
+
+    }
+
+    std::swap( inputs, nextInputs );
+    std::swap( outputs, nextOutputs );
+
+    int rows = filledRows;
+    filledRows = -1;
+
+    return rows;
+
+}
+
+
+// Finds where each chunk of a text dataset starts, by counting the values from the end of the header
+// Scans the file in blocks, without parsing the values
+void dataStream::indexText( std::streamoff dataStart ) {
+
+    const long long valuesPerChunk = (long long)( chunkRows ) * ( numIn + numOut );
+    const long long totalValues = (long long)( numEx ) * ( numIn + numOut );
+
+    vector< char > block( 1 << 20 );
+    std::streamoff offset = dataStart;
+    long long numValues = 0;
+    bool inValue = false;
+
+    input.seekg( dataStart );
+
+    while ( numValues < totalValues && ( input.read( block.data(), block.size() ) || input.gcount() > 0 ) ) {
+
+        std::streamsize length = input.gcount();
+
+        for ( std::streamsize i=0; i<length; i++ ) {
+
+            bool space = std::isspace( static_cast< unsigned char >( block[i] ) );
+
+            // Records the start of the first value of each chunk
+            if ( !space && !inValue ) {
+
+                if ( numValues % valuesPerChunk == 0 )
+                    chunkStarts.push_back( offset + i );
+
+                numValues++;
+
+            }
+
+            inValue = !space;
+
+        }
+
+        offset += length;
+
+    }
+
+    if ( numValues < totalValues ) {
+
+        std::cerr << "Error: " << fileName << " has fewer values than its number of examples! ("
+                  << numValues << " of " << totalValues << ")" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    // The chunks stop at the number of examples, so values past them are ignored
+    chunkStarts.resize( numChunks );
+    input.clear();
+
+}
+
+
+// Reads a chunk into the buffers of the background thread, returning its number of examples
+// Rows start with the fixed input of -1 for the bias weight, as with loadData
+int dataStream::readChunk( int chunk ) {
+
+    int rows = std::min( chunkRows, numEx - chunk * chunkRows );
+
+    input.seekg( chunkStarts[ chunk ] );
+
+    if ( binary ) {
+
+        const recordLayout layout( numIn, numOut, featureType );
+        const size_t outputBytes = layout.recordBytes - layout.inputBytes;
+        vector< char > record( layout.inputBytes );
+
+        for ( int i=0; i<rows; i++ ) {
+
+            double *row = nextInputs[i];
+
+            // Float64 records hold the row as it is stored in memory
+            if ( featureType == dataVals::FEATURES_FLOAT64 )
+                input.read( reinterpret_cast< char * >( row ), layout.inputBytes );
+            else {
+
+                input.read( record.data(), layout.inputBytes );
+                row[0] = -1;
+
+                if ( featureType == dataVals::FEATURES_FLOAT32 )
+                    std::copy( reinterpret_cast< const float * >( record.data() ), reinterpret_cast< const float * >( record.data() ) + numIn, row+1 );
+                else
+                    std::copy( reinterpret_cast< const unsigned char * >( record.data() ), reinterpret_cast< const unsigned char * >( record.data() ) + numIn, row+1 );
+
+            }
+
+            input.read( reinterpret_cast< char * >( nextOutputs[i] ), outputBytes );
+
+        }
+
+    }
+    else {
+
+        for ( int i=0; i<rows; i++ ) {
+
+            nextInputs[i][0] = -1;
+
+            for ( int j=0; j<numIn; j++ )
+                input >> nextInputs[i][ j+1 ];
+
+            for ( int j=0; j<numOut; j++ )
+                input >> nextOutputs[i][j];
+
+        }
+
+    }
+
+    if ( !input ) {
+
+        std::cerr << "Error: Could not read chunk " << chunk << " of " << fileName << "!" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    return rows;
+
+}
+
+
+// Waits for requests and reads the chunks until the stream is destroyed
+void dataStream::prefetchLoop() {
+
+    while ( true ) {
+
+        int chunk;
+
+        {
+            unique_lock< mutex > guard( lock );
+            requested.wait( guard, [this]() { return stopping || pendingChunk >= 0; } );
+
+            if ( stopping )
+                return;
+
+            chunk = pendingChunk;
+            pendingChunk = -1;
+        }
+
+        int rows = readChunk( chunk );
+
+        lock_guard< mutex > guard( lock );
+        filledRows = rows;
+        finished.notify_one();
+
+    }
+
+}
@@ -3,7 +3,7 @@
 
 void trainProgram();
 void testProgram();
-void returnInputs( vector<string> &, int &, double & );
+void returnInputs( vector<string> &, int &, double &, int &, int &, bool &, int &, bool & );
 string filePrompt( int );
 bool test;
 
@@ -29,21 +29,32 @@ void trainProgram() {
 
     // Input variables
     vector<string> fileNames;   // Vector contains name of weight file, training file, output file
-    int epochs;
+    int epochs, batchSize, numThreads, budget;
     double learnRate;
+    bool async, binary;
 
     // Gets inputs from user
-    returnInputs( fileNames, epochs, learnRate );
+    returnInputs( fileNames, epochs, learnRate, batchSize, numThreads, async, budget, binary );
 
     // Reads the file representing the initial neural network
     NeuralNetwork newNetwork = NeuralNetwork( fileNames[0] );
 
     // Trains the network
-    newNetwork.loadData( fileNames[1] );
-    newNetwork.train( epochs, learnRate );
+    //   With a memory budget, the training set is read a chunk at a time instead of loaded at once
+    if ( budget > 0 )
+        newNetwork.trainStream( fileNames[1], size_t( budget ) << 20, epochs, learnRate, batchSize, numThreads, async );
+    else {
+
+        newNetwork.loadData( fileNames[1] );
+        newNetwork.train( epochs, learnRate, batchSize, numThreads, async );
+
+    }
 
     // Writes weights to output file
-    newNetwork.writeWeights( fileNames[2] );
+    if ( binary )
+        newNetwork.writeBinaryModel( fileNames[2] );
+    else
+        newNetwork.writeWeights( fileNames[2] );
 
     return;
 
@@ -81,7 +92,8 @@ void testProgram() {
 
 
 // Handles processing required inputs from user
-void returnInputs( vector<string> &fileNames, int &epochs, double &learnRate ) {
+void returnInputs( vector<string> &fileNames, int &epochs, double &learnRate, int &batchSize, int &numThreads, bool &async,
+                   int &budget, bool &binary ) {
 
     // Append filenames to list
     for ( int i=0; i<3; i++ )
@@ -95,6 +107,33 @@ void returnInputs( vector<string> &fileNames, int &epochs, double &learnRate ) {
     cin >> learnRate;
     cout << "\n";
 
+    cout << "Enter the batch size (1 to update the weights after every example):" << "\n";
+    cin >> batchSize;
+    cout << "\n";
+
+    cout << "Enter the number of threads:" << "\n";
+    cin >> numThreads;
+    cout << "\n";
+
+    // Asynchronous training is only asked for when there are threads to share the weights
+    async = false;
+
+    if ( numThreads > 1 ) {
+
+        cout << "Enter 0 for reproducible training, or 1 for asynchronous (Hogwild) training:" << "\n";
+        cin >> async;
+        cout << "\n";
+
+    }
+
+    cout << "Enter the memory budget for the training set in megabytes (0 to load the whole set):" << "\n";
+    cin >> budget;
+    cout << "\n";
+
+    cout << "Enter 0 to write the weights as text, rounded to 3 decimals, or 1 to write an exact binary model:" << "\n";
+    cin >> binary;
+    cout << "\n";
+
     return;
 
 }
@@ -1,22 +1,64 @@
 #include "neuralNetwork.h"
 #include <iomanip>
 #include <cmath>
+#include <algorithm>
+#include <random>
+#include <charconv>
+#include <cstring>
+#include <cctype>
 
 using namespace metricVals;
+using namespace blockVals;
 using std::make_tuple;
+using std::min;
 
 
 // Reads a file representing the initial neural network
 NeuralNetwork::NeuralNetwork( string fileName ) {
 
-    ifstream inputWeights( fileName );
+    ifstream inputWeights( fileName, std::ios::binary );
+    char magic[ modelVals::MODEL_MAGIC_BYTES ];
+
+    inputWeights.read( magic, modelVals::MODEL_MAGIC_BYTES );
+
+    if ( inputWeights && std::equal( magic, magic + modelVals::MODEL_MAGIC_BYTES, modelVals::MODEL_MAGIC ) ) {
+
+        inputWeights.close();
+        loadBinaryModel( fileName );
+
+    }
+    else
+        readTextModel( inputWeights, fileName );
+
+    // Initializes size of vectors
+    this->inputToHid = vector< double >( this->numHidNodes );
+    this->inputToOut = vector< double >( this->numOutNodes );
+    this->activationsHid = vector< double >( this->numHidNodes+1 );
+    this->activationsOutput = vector< double >( this->numOutNodes );
+
+}
+
+
+// Reads the weights of a text model
+void NeuralNetwork::readTextModel( ifstream &inputWeights, string fileName ) {
+
+    // Text models are parsed from the start
+    inputWeights.clear();
+    inputWeights.seekg( 0 );
 
     inputWeights >> this->numInNodes >> this->numHidNodes >> this->numOutNodes;
 
+    if ( !inputWeights || this->numInNodes <= 0 || this->numHidNodes <= 0 || this->numOutNodes <= 0 ) {
+
+        std::cerr << "Error: Could not read the number of nodes from " << fileName << "!" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
     // Initializes matrix of weights
     // Stores the weights of edges
-    this->weightsInHid = vector< vector<double> >( this->numHidNodes, vector<double>( this->numInNodes+1 ) );
-    this->weightsHidOut = vector< vector<double> >( this->numOutNodes, vector<double>( this->numHidNodes+1 ) );
+    this->weightsInHid = matrix<double>( this->numHidNodes, this->numInNodes+1 );
+    this->weightsHidOut = matrix<double>( this->numOutNodes, this->numHidNodes+1 );
 
     // Reads weights of edges from input layer to hidden layer
     for ( int i=0; i<this->numHidNodes; i++ ) {
@@ -30,52 +72,442 @@ NeuralNetwork::NeuralNetwork( string fileName ) {
             inputWeights >> this->weightsHidOut[i][j];
     }
 
+    // Every layer is sized from the numbers of nodes, so checking the weights were read validates the network once
+    if ( !inputWeights ) {
+
+        std::cerr << "Error: Weight file has fewer weights than its numbers of nodes! (" << fileName << ")" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
     inputWeights.close();
 
-    // Initializes size of vectors
-    this->inputToHid = vector< double >( this->numHidNodes );
-    this->inputToOut = vector< double >( this->numOutNodes );
-    this->activationsInput = vector< double >( this->numInNodes+1 );
-    this->activationsHid = vector< double >( this->numHidNodes+1 );
-    this->activationsOutput = vector< double >( this->numOutNodes );
+}
+
+
+// Maps a binary model
+//   The weights are used in place, so processes loading the same model share its pages until they change the weights
+void NeuralNetwork::loadBinaryModel( string fileName ) {
+
+    if ( !this->modelFile.open( fileName ) || this->modelFile.size() < size_t( modelVals::MODEL_HEADER_BYTES ) ) {
+
+        std::cerr << "Error: Could not map " << fileName << "!" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    // Reads the header
+    const char *start = this->modelFile.data();
+    int32_t header[4];
+    uint64_t expectedSum;
+
+    std::copy( start + modelVals::MODEL_MAGIC_BYTES, start + modelVals::MODEL_MAGIC_BYTES + sizeof( header ),
+               reinterpret_cast< char * >( header ) );
+    std::copy( start + modelVals::MODEL_MAGIC_BYTES + sizeof( header ), start + modelVals::MODEL_MAGIC_BYTES + sizeof( header ) + sizeof( expectedSum ),
+               reinterpret_cast< char * >( &expectedSum ) );
+
+    this->numInNodes = header[0];
+    this->numHidNodes = header[1];
+    this->numOutNodes = header[2];
+
+    if ( this->numInNodes <= 0 || this->numHidNodes <= 0 || this->numOutNodes <= 0 || header[3] != modelVals::WEIGHTS_FLOAT64 ) {
+
+        std::cerr << "Error: Invalid header in binary model! (" << fileName << ")" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    const size_t inHidValues = size_t( this->numHidNodes ) * matrix<double>::strideFor( this->numInNodes+1 );
+    const size_t hidOutValues = size_t( this->numOutNodes ) * matrix<double>::strideFor( this->numHidNodes+1 );
+    const size_t weightBytes = ( inHidValues + hidOutValues ) * sizeof( double );
+    char *weights = this->modelFile.data() + modelVals::MODEL_HEADER_BYTES;
+
+    if ( this->modelFile.size() < modelVals::MODEL_HEADER_BYTES + weightBytes ) {
+
+        std::cerr << "Error: Binary model is shorter than its numbers of nodes! (" << fileName << ")" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    if ( checksum( weights, weightBytes ) != expectedSum ) {
+
+        std::cerr << "Error: Checksum of binary model does not match its weights! (" << fileName << ")" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    double *first = reinterpret_cast< double * >( weights );
+
+    this->weightsInHid = matrix<double>( first, this->numHidNodes, this->numInNodes+1, matrix<double>::strideFor( this->numInNodes+1 ) );
+    this->weightsHidOut = matrix<double>( first + inHidValues, this->numOutNodes, this->numHidNodes+1, matrix<double>::strideFor( this->numHidNodes+1 ) );
 
 }
 
 
 // Reads a file representing the training / testing data
+// The file is mapped, then recognized as a binary dataset, made by the converter, by its header, or else parsed as text
 void NeuralNetwork::loadData( string fileName ) {
 
-    ifstream input( fileName );
+    mappedFile newFile;
+
+    if ( !newFile.open( fileName ) ) {
+
+        std::cerr << "Error: Could not open " << fileName << "!" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    if ( newFile.size() >= size_t( dataVals::DATA_MAGIC_BYTES )
+         && std::equal( newFile.data(), newFile.data() + dataVals::DATA_MAGIC_BYTES, dataVals::DATA_MAGIC ) )
+        loadBinaryData( newFile, fileName );
+    else {
+
+        loadTextData( newFile, fileName );
+        this->dataFile.close();
+
+    }
+
+}
+
+
+// Skips whitespace, including line ends
+static const char *skipSpaces( const char *first, const char *last ) {
+
+    while ( first != last && std::isspace( static_cast< unsigned char >( *first ) ) )
+        first++;
 
-    int _checkInNodes, _checkOutNodes;
-    input >> this->numEx >> _checkInNodes >> _checkOutNodes;
+    return first;
+
+}
+
+
+// Parses a number filling a whole value, allowing a leading '+' as stream extraction does
+template< typename T >
+static bool parseValue( const char *first, const char *last, T &value ) {
+
+    if ( last - first > 1 && first[0] == '+' && first[1] != '-' && first[1] != '+' )
+        first++;
+
+    std::from_chars_result result = std::from_chars( first, last, value );
+
+    return result.ec == std::errc() && result.ptr == last;
+
+}
+
+
+// Parses a text dataset, laid out as with stream extraction: the header, then the values of each example in order
+// Values may be split between lines in any way, as only whitespace separates them
+// The text is split into chunks at whitespace, which threads parse directly into the rows of the dataset
+//   A first pass counts the values and lines of each chunk, so each chunk knows the index of its first value and its first line
+//   Value k goes to example k / ( inputs + outputs ), so a chunk may start in the middle of an example
+//   Values past the number of examples are ignored, and invalid values are reported by line number
+void NeuralNetwork::loadTextData( const mappedFile &file, string fileName ) {
+
+    const char *text = file.data();
+    const char *end = text + file.size();
+
+    // Reads the header
+    const char *cur = text;
+    int header[3];
+    int headerLines = 1;
+
+    for ( int i=0; i<3; i++ ) {
+
+        const char *value = skipSpaces( cur, end );
+        headerLines += int( std::count( cur, value, '\n' ) );
+        cur = std::find_if( value, end, []( char ch ) { return std::isspace( static_cast< unsigned char >( ch ) ); } );
+
+        if ( !parseValue( value, cur, header[i] ) ) {
+
+            std::cerr << "Error: Could not read the size of " << fileName << " on line " << headerLines << "!" << "\n";
+            exit( EXIT_FAILURE );
+
+        }
+
+    }
+
+    this->numEx = header[0];
+
+    if ( this->numEx < 0 ) {
+
+        std::cerr << "Error: " << fileName << " has a negative number of examples!" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    checkNodeCounts( header[1], header[2] );
 
     // Initializes size of matrices
-    this->inputAttributes = vector< vector<double> >( this->numEx, vector<double>( this->numInNodes ) );
-    this->output = vector< vector<int> >( this->numEx, vector<int>( this->numOutNodes ) );
+    //   Inputs start with the fixed input of -1 for the bias weight
+    this->inputAttributes = matrix<double>( this->numEx, this->numInNodes+1 );
+    this->output = matrix<int>( this->numEx, this->numOutNodes );
+
+    const long long valuesPerEx = this->numInNodes + this->numOutNodes;
+    const long long totalValues = (long long)( this->numEx ) * valuesPerEx;
+
+    // Splits the values into chunks that start at whitespace, so no value is split
+    const char *body = cur;
+    size_t bodyBytes = end - body;
+    int numThreads = std::max( 1, int( std::thread::hardware_concurrency() ) );
+    int numChunks = int( min( size_t( numThreads ), bodyBytes / dataVals::PARSE_CHUNK_BYTES + 1 ) );
+
+    vector< const char * > chunkStarts( numChunks+1 );
+
+    for ( int chunk=0; chunk<numChunks; chunk++ ) {
+
+        const char *start = body + bodyBytes * chunk / numChunks;
+
+        while ( start != end && !std::isspace( static_cast< unsigned char >( *start ) ) )
+            start++;
+
+        chunkStarts[ chunk ] = std::max( start, chunk > 0 ? chunkStarts[ chunk-1 ] : body );
+
+    }
+
+    chunkStarts[ numChunks ] = end;
+
+    // Calls a function on each value of a chunk, given its start and end and the number of line ends before it in the chunk
+    auto forValues = [&]( int chunk, const std::function< void( const char *, const char *, int ) > &valueFunction ) {
+
+        const char *first = chunkStarts[ chunk ];
+        const char *last = chunkStarts[ chunk+1 ];
+        int lineEnds = 0;
+
+        while ( first != last ) {
+
+            if ( std::isspace( static_cast< unsigned char >( *first ) ) ) {
+
+                lineEnds += *first == '\n';
+                first++;
+                continue;
+
+            }
+
+            const char *valueEnd = first;
+
+            while ( valueEnd != last && !std::isspace( static_cast< unsigned char >( *valueEnd ) ) )
+                valueEnd++;
+
+            valueFunction( first, valueEnd, lineEnds );
+            first = valueEnd;
+
+        }
+
+        return lineEnds;
+
+    };
+
+    // Counts the values and line ends of each chunk
+    vector< long long > chunkValues( numChunks+1, 0 );
+    vector< int > chunkLines( numChunks+1, 0 );
+    threadPool pool( numChunks );
+
+    pool.run( [&]( int chunk ) {
+
+        chunkLines[ chunk+1 ] = forValues( chunk, [&]( const char *, const char *, int ) { chunkValues[ chunk+1 ]++; } );
+
+    } );
+
+    // Turns the counts into the first value and line of each chunk
+    chunkLines[0] = headerLines;
+
+    for ( int chunk=0; chunk<numChunks; chunk++ ) {
+
+        chunkLines[ chunk+1 ] += chunkLines[ chunk ];
+        chunkValues[ chunk+1 ] += chunkValues[ chunk ];
+
+    }
+
+    if ( chunkValues[ numChunks ] < totalValues ) {
+
+        std::cerr << "Error: " << fileName << " has " << chunkValues[ numChunks ] << " values, fewer than the " << this->numEx
+                  << " examples of " << this->numInNodes << " inputs and " << this->numOutNodes << " outputs in its header!" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    // Parses the values of each chunk, keeping the first invalid value of each
+    vector< int > errorLines( numChunks, 0 );
+    vector< string > errors( numChunks );
+
+    pool.run( [&]( int chunk ) {
+
+        long long index = chunkValues[ chunk ];
+
+        forValues( chunk, [&]( const char *first, const char *last, int lineEnds ) {
+
+            if ( errorLines[ chunk ] != 0 || index >= totalValues )
+                return;
+
+            int ex = int( index / valuesPerEx );
+            int column = int( index % valuesPerEx );
+            bool valid;
+
+            if ( column < this->numInNodes ) {
+
+                // Rows start with the fixed input of -1 for the bias weight
+                if ( column == 0 )
+                    this->inputAttributes[ ex ][0] = -1;
+
+                valid = parseValue( first, last, this->inputAttributes[ ex ][ column+1 ] );
+
+            }
+            else
+                valid = parseValue( first, last, this->output[ ex ][ column - this->numInNodes ] );
+
+            if ( !valid ) {
+
+                errorLines[ chunk ] = chunkLines[ chunk ] + lineEnds;
+                errors[ chunk ] = "has an invalid " + string( column < this->numInNodes ? "input" : "output" ) + " value \""
+                                  + string( first, std::min( last, first + 20 ) ) + "\" for example " + std::to_string( ex+1 );
+
+            }
+
+            index++;
+
+        } );
+
+    } );
+
+    // Reports the first invalid value
+    for ( int chunk=0; chunk<numChunks; chunk++ ) {
+
+        if ( errorLines[ chunk ] != 0 ) {
+
+            std::cerr << "Error: Line " << errorLines[ chunk ] << " of " << fileName << " " << errors[ chunk ]
+                      << " (" << this->numInNodes << " inputs, " << this->numOutNodes << " outputs)!" << "\n";
+            exit( EXIT_FAILURE );
+
+        }
+
+    }
+
+}
+
+
+// Maps a binary dataset
+//   The outputs, and float64 inputs, are used in place in the mapped file
+void NeuralNetwork::loadBinaryData( mappedFile &newFile, string fileName ) {
+
+    if ( newFile.size() < size_t( dataVals::DATA_HEADER_BYTES ) ) {
+
+        std::cerr << "Error: Binary dataset is shorter than its header! (" << fileName << ")" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    // Reads the header
+    int32_t header[4];
+    std::copy( newFile.data() + dataVals::DATA_MAGIC_BYTES, newFile.data() + dataVals::DATA_MAGIC_BYTES + sizeof( header ),
+               reinterpret_cast< char * >( header ) );
+
+    const int featureType = header[3];
+    this->numEx = header[0];
+
+    checkNodeCounts( header[1], header[2] );
+
+    if ( this->numEx < 0 || featureType < dataVals::FEATURES_FLOAT64 || featureType > dataVals::FEATURES_UINT8 ) {
+
+        std::cerr << "Error: Invalid header in binary dataset! (" << fileName << ")" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    const recordLayout layout( this->numInNodes, this->numOutNodes, featureType );
+    char *records = newFile.data() + dataVals::DATA_HEADER_BYTES;
+
+    if ( newFile.size() < dataVals::DATA_HEADER_BYTES + this->numEx * layout.recordBytes ) {
+
+        std::cerr << "Error: Binary dataset is shorter than its number of examples! (" << fileName << ")" << "\n";
+        exit( EXIT_FAILURE );
+
+    }
+
+    // Outputs follow the inputs of each record
+    this->output = matrix<int>( reinterpret_cast< int * >( records + layout.inputBytes ), this->numEx, this->numOutNodes,
+                                layout.recordBytes / sizeof( int ) );
+
+    if ( featureType == dataVals::FEATURES_FLOAT64 )
+        this->inputAttributes = matrix<double>( reinterpret_cast< double * >( records ), this->numEx, this->numInNodes+1,
+                                                layout.recordBytes / sizeof( double ) );
+    else {
+
+        // Narrower inputs are widened into rows starting with the fixed input of -1
+        this->inputAttributes = matrix<double>( this->numEx, this->numInNodes+1 );
+
+        for ( int i=0; i<this->numEx; i++ ) {
+
+            const char *record = records + i * layout.recordBytes;
+            double *row = this->inputAttributes[i];
+
+            row[0] = -1;
+
+            if ( featureType == dataVals::FEATURES_FLOAT32 )
+                std::copy( reinterpret_cast< const float * >( record ), reinterpret_cast< const float * >( record ) + this->numInNodes, row+1 );
+            else
+                std::copy( reinterpret_cast< const unsigned char * >( record ), reinterpret_cast< const unsigned char * >( record ) + this->numInNodes, row+1 );
+
+        }
+
+    }
+
+    // Replaces any earlier mapping only after the views of the new one are in place
+    this->dataFile = std::move( newFile );
+
+}
+
+
+// Verify the dataset matches the weight file
+void NeuralNetwork::checkNodeCounts( int _checkInNodes, int _checkOutNodes ) {
 
-    // Verify weight file matches training file
     if ( this->numInNodes != _checkInNodes || this->numOutNodes != _checkOutNodes ) {
 
         std::cerr << "Error: Number of nodes in weight file does not match number of nodes in training file! ("
                   << this->numInNodes << "," << _checkInNodes << ") ("
                   << this->numOutNodes << "," << _checkOutNodes << ")" << "\n";
-        return;
+        exit( EXIT_FAILURE );
 
     }
 
-    // Reads input and output data
-    for ( int i=0; i<this->numEx; i++ ) {
+}
+
+
+// Writes the exact weights of the neural network as a binary model
+//   The rows are written with their padding, so the file can be mapped and used in place
+void NeuralNetwork::writeBinaryModel( string fileName ) {
 
-        for ( int j=0; j<this->numInNodes; j++ )
-            input >> this->inputAttributes[i][j];
+    ofstream outputModel( fileName, std::ios::binary );
 
-        for ( int j=0; j<this->numOutNodes; j++ )
-            input >> this->output[i][j];
+    if ( !outputModel ) {
+
+        std::cerr << "Error: Could not open " << fileName << "!" << "\n";
+        exit( EXIT_FAILURE );
 
     }
 
-    input.close();
+    const char *inHid = reinterpret_cast< const char * >( this->weightsInHid[0] );
+    const char *hidOut = reinterpret_cast< const char * >( this->weightsHidOut[0] );
+    const size_t inHidBytes = size_t( this->numHidNodes ) * this->weightsInHid.stride() * sizeof( double );
+    const size_t hidOutBytes = size_t( this->numOutNodes ) * this->weightsHidOut.stride() * sizeof( double );
+
+    // The checksum covers both matrices as one block, as they are in the file
+    //   Rows are padded to MATRIX_ALIGN, so the first matrix is a multiple of 8 bytes
+    const uint64_t weightSum = checksum( hidOut, hidOutBytes, checksum( inHid, inHidBytes ) );
+
+    // Writes the header, padded with zeros
+    vector<char> header( modelVals::MODEL_HEADER_BYTES, 0 );
+    const int32_t sizes[4] = { this->numInNodes, this->numHidNodes, this->numOutNodes, modelVals::WEIGHTS_FLOAT64 };
+
+    std::copy( modelVals::MODEL_MAGIC, modelVals::MODEL_MAGIC + modelVals::MODEL_MAGIC_BYTES, header.begin() );
+    std::copy( reinterpret_cast< const char * >( sizes ), reinterpret_cast< const char * >( sizes ) + sizeof( sizes ),
+               header.begin() + modelVals::MODEL_MAGIC_BYTES );
+    std::copy( reinterpret_cast< const char * >( &weightSum ), reinterpret_cast< const char * >( &weightSum ) + sizeof( weightSum ),
+               header.begin() + modelVals::MODEL_MAGIC_BYTES + sizeof( sizes ) );
+
+    outputModel.write( header.data(), header.size() );
+    outputModel.write( inHid, inHidBytes );
+    outputModel.write( hidOut, hidOutBytes );
+    outputModel.close();
 
 }
 
@@ -195,9 +627,85 @@ void NeuralNetwork::trimPrecision( ofstream &output, double number ) {
 }
 
 
-// Trains the network according to number of epochs and learning rate
+// Trains the network according to number of epochs, learning rate, batch size and number of threads
 // Based on Figure 18.24 in the textbook
-void NeuralNetwork::train( int epochs, double learnRate ) {
+void NeuralNetwork::train( int epochs, double learnRate, int batchSize, int numThreads, bool async ) {
+
+    bool batches = prepareTraining( batchSize, numThreads, async );
+    threadPool pool( numThreads );
+
+    // Train for specified number of epochs
+    for ( int iteration=0; iteration<epochs; iteration++ ) {
+
+        if ( batches )
+            trainBatches( pool, learnRate, batchSize, async );
+        else
+            trainExamples( learnRate );
+
+    }
+
+}
+
+
+// Checks how the settings split the work between threads, and allocates the buffers of each thread for batches
+// Returns whether batches are used, and reduces the number of threads to the number that can be given work
+//   A batch of one example has nothing to split across threads, unless threads train asynchronously
+//   Batches are split by example, so a batch gives work to at most as many threads as it has examples
+bool NeuralNetwork::prepareTraining( int batchSize, int &numThreads, bool async ) {
+
+    numThreads = std::max( 1, numThreads );
+
+    if ( batchSize <= 1 && ( !async || numThreads == 1 ) ) {
+
+        if ( numThreads > 1 )
+            cout << "Note: A batch size of 1 has no examples to split between threads, so training uses 1 thread. "
+                 << "Use a larger batch size or asynchronous training to use " << numThreads << " threads." << "\n";
+
+        numThreads = 1;
+        return false;
+
+    }
+
+    if ( !async && batchSize < numThreads ) {
+
+        cout << "Note: Batches of " << batchSize << " examples are split between " << batchSize << " of the "
+             << numThreads << " threads." << "\n";
+
+        numThreads = batchSize;
+
+    }
+
+    int chunkRows = min( batchSize, CHUNK_ROWS );
+
+    // Initializes size of batch matrices
+    this->buffers = vector< chunkBuffers >( numThreads );
+    this->changes = vector< weightChanges >( numThreads );
+
+    for ( int thread=0; thread<numThreads; thread++ ) {
+
+        chunkBuffers &chunk = this->buffers[ thread ];
+
+        chunk.hid = matrix<double>( chunkRows, this->numHidNodes+1 );
+        chunk.output = matrix<double>( chunkRows, this->numOutNodes );
+        chunk.inputToHid = matrix<double>( chunkRows, this->numHidNodes );
+        chunk.inputToOut = matrix<double>( chunkRows, this->numOutNodes );
+        chunk.deltaOut = matrix<double>( chunkRows, this->numOutNodes );
+        chunk.deltaHid = matrix<double>( chunkRows, this->numHidNodes );
+
+        this->changes[ thread ].inHid = matrix<double>( this->numHidNodes, this->numInNodes+1 );
+        this->changes[ thread ].hidOut = matrix<double>( this->numOutNodes, this->numHidNodes+1 );
+
+    }
+
+    return true;
+
+}
+
+
+// Trains on every example once, updating the weights after each example
+void NeuralNetwork::trainExamples( double learnRate ) {
+
+    const simdKernels< double > &simd = kernels< double >();
 
     // Stores error
     vector< double > deltaOut = vector< double >( this->numOutNodes );
@@ -205,58 +713,249 @@ void NeuralNetwork::train( int epochs, double learnRate ) {
 
     int nodeNum;
 
-    // Train for specified number of epochs
+    for ( int trainEx=0; trainEx<this->numEx; trainEx++ ) {
+
+        computeOutputs( trainEx );
+
+        // Reset error vectors
+        std::fill( deltaOut.begin(), deltaOut.end(), 0 );
+        std::fill( deltaHid.begin(), deltaHid.end(), 0 );
+
+        //// Propagate deltas backward from output layer to input layer ////
+
+        // Output Layer
+        for ( nodeNum=0; nodeNum<this->numOutNodes; nodeNum++ )
+            deltaOut[ nodeNum ] = sigDeriv( activationsOutput[ nodeNum ] ) * ( this->output[ trainEx ][ nodeNum ] - activationsOutput[ nodeNum ] );
+
+        // Hidden Layer
+        for ( nodeNum=0; nodeNum<this->numHidNodes; nodeNum++ ) {
+
+            // Uses nodeNum+1 in weightsHidOut[j][ nodeNum+1 ]
+            //   because there is no input to the dummy node (activation -1) to backpropagate to
+            for ( int j=0; j<this->numOutNodes; j++ )
+                deltaHid[ nodeNum ] += ( weightsHidOut[j][ nodeNum+1 ] * deltaOut[j] );
+
+            deltaHid[ nodeNum ] *= sigDeriv( activationsHid[ nodeNum+1 ] );
+
+        }
+
+        //// Update every weight in network using deltas ////
+
+        // Hidden to Output Weights
+        // Each row of weights is updated in order, so the innermost loop is unit stride
+        simd.rank1Update( this->weightsHidOut[0], this->weightsHidOut.stride(), this->numOutNodes, this->numHidNodes+1,
+                          learnRate, deltaOut.data(), activationsHid.data() );
+
+        // Input to Hidden Weights
+        simd.rank1Update( this->weightsInHid[0], this->weightsInHid.stride(), this->numHidNodes, this->numInNodes+1,
+                          learnRate, deltaHid.data(), activationsInput.data() );
+
+    }
+
+}
+
+
+// Trains the network on a dataset read from disk a chunk at a time, keeping the two chunks in memory within the budget
+// The chunks are visited in a new random order every epoch, and the next chunk is read while the current one is trained on
+//   Each chunk is trained on as a dataset of its own, so the last batch of a chunk may be smaller
+//   The threads and their buffers are set up once and used for every chunk
+void NeuralNetwork::trainStream( string fileName, size_t budget, int epochs, double learnRate, int batchSize, int numThreads, bool async ) {
+
+    dataStream stream( fileName, budget );
+
+    checkNodeCounts( stream.inputs(), stream.outputs() );
+
+    bool batches = prepareTraining( batchSize, numThreads, async );
+    threadPool pool( numThreads );
+
+    // Shuffles the order of the chunks for every epoch up front, so the first chunk of an epoch is read during the last of the previous one
+    std::default_random_engine generator;
+    vector< int > order;
+
     for ( int iteration=0; iteration<epochs; iteration++ ) {
 
-        for ( int trainEx=0; trainEx<this->numEx; trainEx++ ) {
+        vector< int > epochOrder( stream.chunks() );
+
+        for ( int chunk=0; chunk<stream.chunks(); chunk++ )
+            epochOrder[ chunk ] = chunk;
 
-            computeOutputs( trainEx );
+        std::shuffle( epochOrder.begin(), epochOrder.end(), generator );
+        order.insert( order.end(), epochOrder.begin(), epochOrder.end() );
 
-            // Reset error vectors
-            std::fill( deltaOut.begin(), deltaOut.end(), 0 );
-            std::fill( deltaHid.begin(), deltaHid.end(), 0 );
+    }
 
-            //// Propagate deltas backward from output layer to input layer ////
+    // The dataset matrices hold the chunk being trained on
+    this->inputAttributes = matrix<double>();
+    this->output = matrix<int>();
+    this->dataFile.close();
 
-            // Output Layer
-            for ( nodeNum=0; nodeNum<this->numOutNodes; nodeNum++ )
-                deltaOut[ nodeNum ] = sigDeriv( inputToOut[ nodeNum ] ) * ( this->output[ trainEx ][ nodeNum ] - activationsOutput[ nodeNum ] );
+    if ( !order.empty() )
+        stream.request( order[0] );
 
-            // Hidden Layer
-            for ( nodeNum=0; nodeNum<this->numHidNodes; nodeNum++ ) {
+    for ( size_t i=0; i<order.size(); i++ ) {
 
-                // Uses nodeNum+1 in weightsHidOut[j][ nodeNum+1 ]
-                //   because there is no input to the dummy node (activation -1) to backpropagate to
-                for ( int j=0; j<this->numOutNodes; j++ )
-                    deltaHid[ nodeNum ] += ( weightsHidOut[j][ nodeNum+1 ] * deltaOut[j] );
+        this->numEx = stream.next( this->inputAttributes, this->output );
 
-                deltaHid[ nodeNum ] *= sigDeriv( inputToHid[ nodeNum ] );
+        if ( i+1 < order.size() )
+            stream.request( order[ i+1 ] );
 
-            }
+        if ( batches )
+            trainBatches( pool, learnRate, batchSize, async );
+        else
+            trainExamples( learnRate );
+
+    }
 
-            //// Update every weight in network using deltas ////
+}
 
-            // Hidden to Output Weights
-            for ( int i=0; i<this->numHidNodes+1; i++ ) {
 
-                for ( int j=0; j<this->numOutNodes; j++ )
-                    this->weightsHidOut[j][i] += learnRate * activationsHid[i] * deltaOut[j];
+// Trains on every batch of consecutive examples once, with a single update of the weights per batch
+// Each batch is split by example between the threads of the pool, and the last batch may be smaller
+//   Each thread sums the changes over its share of the batch, then applies the sums of every thread, added in thread order,
+//   to its share of the rows of weights
+//   The shares and the order of the sums are fixed, so runs with the same number of threads give the same result
+//   The pool runs a single task, and its threads meet at a barrier after the sums and after the update
+// If asynchronous, each thread trains on its own part of the data, updating the shared weights after each of its batches
+//   Threads read and write weights while others update them, as in Hogwild, so the result depends on their timing
+void NeuralNetwork::trainBatches( threadPool &pool, double learnRate, int batchSize, bool async ) {
 
-            }
+    int numThreads = pool.size();
+    int numRows = this->numHidNodes + this->numOutNodes;
 
-            // Input to Hidden Weights
-            for ( int i=0; i<this->numInNodes+1; i++ ) {
+    // Trains on the batches from firstEx up to lastEx using the buffers of one thread
+    auto trainRange = [&]( int firstEx, int lastEx, int thread ) {
 
-                for ( int j=0; j<this->numHidNodes; j++ )
-                    this->weightsInHid[j][i] += learnRate * activationsInput[i] * deltaHid[j];
+        for ( ; firstEx<lastEx; firstEx+=batchSize ) {
 
-            }
+            int batchRows = min( batchSize, lastEx - firstEx );
+
+            computeRangeChanges( firstEx, firstEx + batchRows, this->buffers[ thread ], this->changes[ thread ] );
+            applyChanges( &this->changes[ thread ], 1, 0, numRows, learnRate / batchRows );
 
         }
 
+    };
+
+    // Asynchronous training
+    if ( async ) {
+
+        pool.run( [&]( int thread ) {
+
+            trainRange( this->numEx * thread / numThreads, this->numEx * ( thread+1 ) / numThreads, thread );
+
+        } );
+
+        return;
+
     }
 
-    return;
+    // A single thread trains directly, without waking the pool
+    if ( numThreads == 1 ) {
+
+        trainRange( 0, this->numEx, 0 );
+        return;
+
+    }
+
+    pool.run( [&]( int thread ) {
+
+        for ( int firstEx=0; firstEx<this->numEx; firstEx+=batchSize ) {
+
+            int batchRows = min( batchSize, this->numEx - firstEx );
+            int sharing = min( numThreads, batchRows );
+
+            if ( thread < sharing )
+                computeRangeChanges( firstEx + batchRows * thread / sharing, firstEx + batchRows * ( thread+1 ) / sharing,
+                                     this->buffers[ thread ], this->changes[ thread ] );
+
+            pool.barrier();
+
+            applyChanges( this->changes.data(), sharing, numRows * thread / numThreads, numRows * ( thread+1 ) / numThreads,
+                          learnRate / batchRows );
+
+            pool.barrier();
+
+        }
+
+    } );
+
+}
+
+
+// Computes the sums of the changes to each weight over consecutive examples, a chunk of CHUNK_ROWS examples at a time
+// Each chunk after the first adds its changes to the sums
+void NeuralNetwork::computeRangeChanges( int firstEx, int lastEx, chunkBuffers &chunk, weightChanges &sums ) {
+
+    for ( int ex=firstEx; ex<lastEx; ex+=CHUNK_ROWS )
+        computeChunkChanges( ex, min( CHUNK_ROWS, lastEx - ex ), chunk, sums, ex != firstEx );
+
+}
+
+
+// Computes the sums of the changes to each weight over a chunk of consecutive examples, adding them to the sums if asked
+// Same steps as train, with each loop over nodes done for every example of the chunk as a matrix product
+void NeuralNetwork::computeChunkChanges( int firstEx, int numRows, chunkBuffers &chunk, weightChanges &sums, bool add ) {
+
+    int nodeNum;
+
+    computeChunkOutputs( firstEx, numRows, chunk );
+
+    //// Propagate deltas backward from output layer to input layer ////
+
+    // Output Layer
+    for ( int ex=0; ex<numRows; ex++ ) {
+
+        for ( nodeNum=0; nodeNum<this->numOutNodes; nodeNum++ )
+            chunk.deltaOut[ ex ][ nodeNum ] = sigDeriv( chunk.output[ ex ][ nodeNum ] )
+                                              * ( this->output[ firstEx+ex ][ nodeNum ] - chunk.output[ ex ][ nodeNum ] );
+
+    }
+
+    // Hidden Layer
+    // The dummy node has no input to backpropagate to, so the bias weights are skipped
+    multiply( chunk.deltaOut[0], chunk.deltaOut.stride(), this->weightsHidOut[0] + 1, this->weightsHidOut.stride(),
+              chunk.deltaHid[0], chunk.deltaHid.stride(), numRows, this->numOutNodes, this->numHidNodes );
+
+    for ( int ex=0; ex<numRows; ex++ ) {
+
+        for ( nodeNum=0; nodeNum<this->numHidNodes; nodeNum++ )
+            chunk.deltaHid[ ex ][ nodeNum ] *= sigDeriv( chunk.hid[ ex ][ nodeNum+1 ] );
+
+    }
+
+    //// Sum the changes to every weight in network over the chunk ////
+    multiplyTransposedSum( chunk.deltaOut[0], chunk.deltaOut.stride(), chunk.hid[0], chunk.hid.stride(),
+                           sums.hidOut[0], sums.hidOut.stride(), numRows, this->numOutNodes, this->numHidNodes+1, add );
+    multiplyTransposedSum( chunk.deltaHid[0], chunk.deltaHid.stride(), this->inputAttributes[ firstEx ], this->inputAttributes.stride(),
+                           sums.inHid[0], sums.inHid.stride(), numRows, this->numHidNodes, this->numInNodes+1, add );
+
+}
+
+
+// Adds the sums of the changes of the threads to a range of rows of weights, scaled by the rate
+// The sums of later threads are added to the first in order, so the total does not depend on which thread adds them
+void NeuralNetwork::applyChanges( weightChanges *sums, int numSums, int firstRow, int lastRow, double rate ) {
+
+    const simdKernels< double > &simd = kernels< double >();
+
+    for ( int row=firstRow; row<lastRow; row++ ) {
+
+        // Input to Hidden Weights, then Hidden to Output Weights
+        bool hidRow = row < this->numHidNodes;
+        int index = hidRow ? row : row - this->numHidNodes;
+        int numCols = hidRow ? this->numInNodes+1 : this->numHidNodes+1;
+        double *weights = hidRow ? this->weightsInHid[ index ] : this->weightsHidOut[ index ];
+
+        auto sumRow = [&]( int thread ) { return hidRow ? sums[ thread ].inHid[ index ] : sums[ thread ].hidOut[ index ]; };
+
+        double *sum = sumRow( 0 );
+
+        for ( int thread=1; thread<numSums; thread++ )
+            simd.axpy( sum, numCols, 1.0, sumRow( thread ) );
+
+        simd.axpy( weights, numCols, rate, sum );
+
+    }
 
 }
 
@@ -305,72 +1004,155 @@ void NeuralNetwork::test() {
 // Propagate the inputs forward to compute the outputs for a given input example
 void NeuralNetwork::computeOutputs( int curEx ) {
 
-    int nodeNum;
-
     // Fixed input of -1 for bias weight
-    this->activationsInput[0] = -1;
+    // The rows of the dataset already start with it, so the row is used as the input layer
+    this->activationsInput = span< const double >( this->inputAttributes[ curEx ], this->numInNodes+1 );
     this->activationsHid[0] = -1;
 
-    // Copies inputs to input layer
-    for ( nodeNum=0; nodeNum<this->numInNodes; nodeNum++ )
-        this->activationsInput[ nodeNum+1 ] = this->inputAttributes[ curEx ][ nodeNum ];
-
     // Propagates to hidden layer
-    for ( nodeNum=0; nodeNum<this->numHidNodes; nodeNum++ ) {
+    forwardLayer( activationsInput, this->weightsInHid, span< double >( inputToHid.data(), this->numHidNodes ),
+                  span< double >( activationsHid.data() + 1, this->numHidNodes ) );
+
+    // Propagates to output layer
+    forwardLayer( span< const double >( activationsHid.data(), this->numHidNodes+1 ), this->weightsHidOut,
+                  span< double >( inputToOut.data(), this->numOutNodes ), span< double >( activationsOutput.data(), this->numOutNodes ) );
 
-        this->inputToHid[ nodeNum ] = this->activation( activationsInput, this->weightsInHid[ nodeNum ] );
-        this->activationsHid[ nodeNum+1 ] = this->sig( inputToHid[ nodeNum ] );
+}
 
-    }
+
+// Propagate a chunk of inputs forward to compute the outputs for consecutive examples
+void NeuralNetwork::computeChunkOutputs( int firstEx, int numRows, chunkBuffers &chunk ) {
+
+    const simdKernels< double > &simd = kernels< double >();
+
+    // Fixed input of -1 for bias weight
+    // The rows of the dataset already start with it, so they are used as the input layer
+    for ( int ex=0; ex<numRows; ex++ )
+        chunk.hid[ ex ][0] = -1;
+
+    // Propagates to hidden layer
+    multiplyTransposed( this->inputAttributes[ firstEx ], this->inputAttributes.stride(), this->weightsInHid[0], this->weightsInHid.stride(),
+                        chunk.inputToHid[0], chunk.inputToHid.stride(), numRows, this->numInNodes+1, this->numHidNodes );
+
+    for ( int ex=0; ex<numRows; ex++ )
+        simd.sigmoid( chunk.inputToHid[ ex ], chunk.hid[ ex ] + 1, this->numHidNodes );
 
     // Propagates to output layer
-    for ( nodeNum=0; nodeNum<this->numOutNodes; nodeNum++ ) {
+    multiplyTransposed( chunk.hid[0], chunk.hid.stride(), this->weightsHidOut[0], this->weightsHidOut.stride(),
+                        chunk.inputToOut[0], chunk.inputToOut.stride(), numRows, this->numHidNodes+1, this->numOutNodes );
+
+    for ( int ex=0; ex<numRows; ex++ )
+        simd.sigmoid( chunk.inputToOut[ ex ], chunk.output[ ex ], this->numOutNodes );
+
+}
+
+
+// Computes C = A * B^T
+// A has rows x inner entries, B has cols x inner entries and C has rows x cols entries
+//   Blocks of rows of A are multiplied with segments of every row of B, so the segments stay in cache
+void NeuralNetwork::multiplyTransposed( const double *A, int strideA, const double *B, int strideB,
+                                        double *C, int strideC, int rows, int inner, int cols ) {
+
+    const simdKernels< double > &simd = kernels< double >();
+
+    for ( int i=0; i<rows; i++ )
+        std::fill( C + size_t( i ) * strideC, C + size_t( i ) * strideC + cols, 0 );
+
+    for ( int rowStart=0; rowStart<rows; rowStart+=BLOCK_ROWS ) {
 
-        this->inputToOut[ nodeNum ] = this->activation( activationsHid, this->weightsHidOut[ nodeNum ] );
-        this->activationsOutput[ nodeNum ] = this->sig( inputToOut[ nodeNum ] );
+        int rowEnd = min( rowStart + BLOCK_ROWS, rows );
+
+        for ( int kStart=0; kStart<inner; kStart+=BLOCK_INNER ) {
+
+            int kEnd = min( kStart + BLOCK_INNER, inner );
+
+            for ( int i=rowStart; i<rowEnd; i++ )
+                simd.matVec( B + kStart, strideB, cols, A + size_t( i ) * strideA + kStart, kEnd - kStart, C + size_t( i ) * strideC );
+
+        }
 
     }
 
 }
 
 
-// Computes activation of a neuron given the activations of the previous layer and weights of connections
-double NeuralNetwork::activation( vector<double> prevActivations, vector<double> weights ) {
+// Computes C = A * B
+// A has rows x inner entries, B has inner x cols entries and C has rows x cols entries
+//   Rows of B are added to rows of C, so the innermost loop is unit stride
+void NeuralNetwork::multiply( const double *A, int strideA, const double *B, int strideB,
+                              double *C, int strideC, int rows, int inner, int cols ) {
 
-    // Make sure both arrays are the same size
-    int numPrevNeurons = prevActivations.size();
-    int _numWeights = weights.size();
+    const simdKernels< double > &simd = kernels< double >();
 
-    if ( numPrevNeurons != _numWeights ) {
+    for ( int i=0; i<rows; i++ ) {
 
-        std::cerr << "Error: Size of previous layer and weights is not the same! ("
-                  << numPrevNeurons << "," << _numWeights << ")" << "\n";
+        const double *a = A + size_t( i ) * strideA;
+        double *c = C + size_t( i ) * strideC;
+
+        std::fill( c, c + cols, 0 );
+
+        for ( int k=0; k<inner; k++ )
+            simd.axpy( c, cols, a[k], B + size_t( k ) * strideB );
+
+    }
+
+}
 
-        exit( EXIT_FAILURE );
+
+// Computes C = A^T * B, summing over the rows of A and B, or adds it to C
+// A has rows x cols entries, B has rows x inner entries and C has cols x inner entries
+//   Each row of A and B adds an outer product to C, so the innermost loop is unit stride
+//   C is updated one tile at a time, so the tile stays in cache while every row is added
+void NeuralNetwork::multiplyTransposedSum( const double *A, int strideA, const double *B, int strideB,
+                                           double *C, int strideC, int rows, int cols, int inner, bool add ) {
+
+    const simdKernels< double > &simd = kernels< double >();
+
+    if ( !add ) {
+
+        for ( int j=0; j<cols; j++ )
+            std::fill( C + size_t( j ) * strideC, C + size_t( j ) * strideC + inner, 0 );
 
     }
 
-    double neuronActivation = 0;
+    for ( int jStart=0; jStart<cols; jStart+=BLOCK_TILE ) {
+
+        int jEnd = min( jStart + BLOCK_TILE, cols );
+
+        for ( int kStart=0; kStart<inner; kStart+=BLOCK_INNER ) {
 
-    for ( int i=0; i<numPrevNeurons; i++ )
-        neuronActivation += prevActivations[i] * weights[i];
+            int kEnd = min( kStart + BLOCK_INNER, inner );
 
-    return neuronActivation;
+            for ( int i=0; i<rows; i++ )
+                simd.rank1Update( C + size_t( jStart ) * strideC + kStart, strideC, jEnd - jStart, kEnd - kStart,
+                                  1.0, A + size_t( i ) * strideA + jStart, B + size_t( i ) * strideB + kStart );
+
+        }
+
+    }
 
 }
 
 
+// Computes the weighted sums and activations of a layer given the activations of the previous layer
+// Each row of weights holds the weights of connections to one node of the layer
+void NeuralNetwork::forwardLayer( span< const double > prevActivations, const matrix<double> &weights,
+                                  span< double > inputs, span< double > activations ) {
+
+    const simdKernels< double > &simd = kernels< double >();
 
-// Sigmoid function to calculate output of perceptron
-double NeuralNetwork::sig( double x ) {
+    std::fill( inputs.data(), inputs.data() + inputs.size(), 0 );
 
-    return 1 / ( 1 + exp(-x) );
+    simd.matVec( weights[0], weights.stride(), inputs.size(), prevActivations.data(), prevActivations.size(), inputs.data() );
+    simd.sigmoid( inputs.data(), activations.data(), activations.size() );
 
 }
 
+
 // Derivative of Sigmoid function used for updating weights
-double NeuralNetwork::sigDeriv( double x ) {
+// Given the activation a = sig(x) already computed by the forward pass, sig'(x) = a * ( 1 - a )
+double NeuralNetwork::sigDeriv( double activation ) {
 
-    return sig(x) * ( 1 - sig(x) );
+    return activation * ( 1 - activation );
 
 }
@@ -4,6 +4,14 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <new>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <mm_malloc.h>
 
 
 using std::vector;
@@ -27,25 +35,418 @@ namespace metricVals {
 }
 
 
+// Used for matrix storage
+namespace matrixVals {
+
+   const int MATRIX_ALIGN = 64;     // Alignment of each row in bytes
+
+}
+
+
+// Used for the binary dataset format
+//   A header of DATA_HEADER_BYTES holds DATA_MAGIC, then the number of examples, inputs and outputs and the feature type as 32-bit integers
+//   Then each example is a record of its inputs followed by its outputs as 32-bit integers, each part padded to MATRIX_ALIGN bytes
+//   Float64 inputs are stored as rows of the dataset matrix, starting with the -1 for the bias, so they are used in place
+//   Float32 and uint8 inputs are stored without the bias and converted to double when loaded
+//   Values are stored in the byte order of the machine
+namespace dataVals {
+
+   const char DATA_MAGIC[] = "NNDATA01";
+   const int DATA_MAGIC_BYTES = 8;
+   const int DATA_HEADER_BYTES = 64;
+
+   const int FEATURES_FLOAT64 = 0;
+   const int FEATURES_FLOAT32 = 1;
+   const int FEATURES_UINT8 = 2;
+
+   const size_t PARSE_CHUNK_BYTES = 1 << 20;    // Least text parsed by each thread when loading a text dataset
+
+}
+
+
+// Used for the binary model format
+//   A header of MODEL_HEADER_BYTES holds MODEL_MAGIC, then the numbers of input, hidden and output nodes and the weight type
+//   as 32-bit integers, then a 64-bit checksum of the weights
+//   Then the rows of weightsInHid and weightsHidOut, stored exactly as the rows of the matrices so they are used in place
+//   Values are stored in the byte order of the machine
+namespace modelVals {
+
+   const char MODEL_MAGIC[] = "NNMODEL1";
+   const int MODEL_MAGIC_BYTES = 8;
+   const int MODEL_HEADER_BYTES = 64;
+
+   const int WEIGHTS_FLOAT64 = 0;   // The only weight type, since the network computes in double
+
+}
+
+
+// Used for cache blocking of matrix products
+namespace blockVals {
+
+   const int BLOCK_ROWS = 64;       // Rows of the result computed together
+   const int BLOCK_INNER = 256;     // Length of the dot product segments
+   const int BLOCK_TILE = 16;       // Rows of a summed result updated together
+   const int CHUNK_ROWS = 64;       // Examples a thread computes together, adding their weight changes to its sums
+
+}
+
+
+// Used for selecting the instruction set of the vector kernels
+namespace simdVals {
+
+   const int SIMD_SCALAR = 0;
+   const int SIMD_AVX2 = 1;
+   const int SIMD_AVX512 = 2;
+
+}
+
+
+// Vector kernels used by the forward and backward passes
+// Each instruction set has its own version of each kernel, and the scalar version runs on any processor
+//   Versions agree within rounding, since the vector versions sum in a different order and fuse multiplies and adds
+template< typename T >
+struct simdKernels {
+
+    int level;
+    bool fastSigmoid;
+
+    // Returns the dot product of two arrays
+    T (*dot)( const T *, const T *, int );
+
+    // Adds the products of the rows of a matrix with a vector to an array
+    //   out[j] += W[j] . x, for rows W[j] given by the first row and the stride
+    void (*matVec)( const T *, int, int, const T *, int, T * );
+
+    // Adds a scaled outer product to a matrix
+    //   W[j][i] += scale * v[i] * u[j]
+    void (*rank1Update)( T *, int, int, int, T, const T *, const T * );
+
+    // Adds a scaled array to another
+    //   y[i] += scale * x[i]
+    void (*axpy)( T *, int, T, const T * );
+
+    // Applies the sigmoid function to an array, writing the results to another
+    //   Setting NN_SIGMOID to "fast" picks an approximate sigmoid, with an error below 2e-9 for double and 1e-6 for float
+    void (*sigmoid)( const T *, T *, int );
+
+};
+
+// Returns the kernels for the best instruction set supported by the processor, picked on the first call
+template< typename T >
+const simdKernels< T > &kernels();
+
+template<> const simdKernels< double > &kernels< double >();
+template<> const simdKernels< float > &kernels< float >();
+
+// Returns the kernels for an instruction set, with the accurate or approximate sigmoid, as used by the kernel tests
+// The instruction set must be supported by the processor
+template< typename T >
+simdKernels< T > kernelsFor( int, bool );
+
+// Returns the best instruction set supported by the processor, ignoring NN_SIMD
+int supportedSimdLevel();
+
+
+// Non-owning view of consecutive values, such as a layer of activations or a row of a matrix
+template< typename T >
+class span {
+
+public:
+
+    span() : first( nullptr ), length( 0 ) {}
+    span( T *first, int length ) : first( first ), length( length ) {}
+
+    T &operator[]( int i ) const { return first[i]; }
+
+    T *data() const { return first; }
+    int size() const { return length; }
+
+private:
+
+    T *first;
+    int length;
+
+};
+
+
+// Allocates memory aligned for matrix rows
+template< typename T >
+struct alignedAllocator {
+
+    typedef T value_type;
+
+    alignedAllocator() {}
+    template< typename U > alignedAllocator( const alignedAllocator<U> & ) {}
+
+    T *allocate( size_t n ) {
+
+        void *memory = _mm_malloc( n * sizeof(T), matrixVals::MATRIX_ALIGN );
+
+        if ( memory == nullptr )
+            throw std::bad_alloc();
+
+        return static_cast< T * >( memory );
+
+    }
+
+    void deallocate( T *memory, size_t ) { _mm_free( memory ); }
+
+};
+
+template< typename T, typename U >
+bool operator==( const alignedAllocator<T> &, const alignedAllocator<U> & ) { return true; }
+
+template< typename T, typename U >
+bool operator!=( const alignedAllocator<T> &, const alignedAllocator<U> & ) { return false; }
+
+
+// Matrix stored in a single row-major block
+// Each row starts on an aligned address, so rows are padded with zeros up to the stride
+template< typename T >
+class matrix {
+
+public:
+
+    matrix() : numRows(0), numCols(0), rowStride(0), external( nullptr ) {}
+
+    // Initializes a matrix of zeros
+    matrix( int rows, int cols ) : numRows( rows ), numCols( cols ), rowStride( strideFor( cols ) ), external( nullptr ) {
+
+        values = vector< T, alignedAllocator<T> >( size_t( rows ) * rowStride );
+
+    }
+
+    // Views rows stored elsewhere, such as in a mapped file, which must outlive the matrix
+    matrix( T *first, int rows, int cols, int stride ) : numRows( rows ), numCols( cols ), rowStride( stride ), external( first ) {}
+
+    // Returns the start of a row
+    T *operator[]( int row ) { return start() + size_t( row ) * rowStride; }
+    const T *operator[]( int row ) const { return start() + size_t( row ) * rowStride; }
+
+    int rows() const { return numRows; }
+    int cols() const { return numCols; }
+
+    // Distance between the starts of consecutive rows
+    int stride() const { return rowStride; }
+
+    // Returns the stride of a matrix with a given number of columns
+    static int strideFor( int cols ) {
+
+        const int rowAlign = matrixVals::MATRIX_ALIGN / sizeof(T);
+        return ( cols + rowAlign - 1 ) / rowAlign * rowAlign;
+
+    }
+
+private:
+
+    T *start() { return external != nullptr ? external : values.data(); }
+    const T *start() const { return external != nullptr ? external : values.data(); }
+
+    int numRows, numCols, rowStride;
+    vector< T, alignedAllocator<T> > values;
+    T *external;                    // Rows stored elsewhere, or null if the matrix owns its rows
+
+};
+
+
+// Whole file mapped into memory
+// The pages are copied on write, so changes are never written back to the file
+class mappedFile {
+
+public:
+
+    mappedFile() : start( nullptr ), length( 0 ) {}
+    ~mappedFile() { close(); }
+
+    mappedFile( const mappedFile & ) = delete;
+    mappedFile &operator=( const mappedFile & ) = delete;
+    mappedFile( mappedFile && );
+    mappedFile &operator=( mappedFile && );
+
+    // Maps a file, returning false if it could not be opened or mapped
+    bool open( string );
+
+    // Unmaps the file
+    void close();
+
+    char *data() const { return start; }
+    size_t size() const { return length; }
+
+private:
+
+    char *start;
+    size_t length;
+
+};
+
+
+// Returns a checksum of a block of bytes, for detecting damaged files
+// Uses FNV-1a over 64-bit words, followed by any remaining bytes
+//   Passing the checksum of a previous block whose length is a multiple of 8 continues it, as if the blocks were one
+const uint64_t CHECKSUM_START = 14695981039346656037ULL;
+uint64_t checksum( const char *, size_t, uint64_t = CHECKSUM_START );
+
+
+// Sizes in bytes of each record of a binary dataset
+struct recordLayout {
+
+    recordLayout( int, int, int );
+
+    size_t inputBytes;              // Inputs, padded to MATRIX_ALIGN
+    size_t recordBytes;             // Inputs and outputs, padded to MATRIX_ALIGN
+
+};
+
+
+// Activations and deltas for a chunk of examples, one row per example
+// The inputs are read from the dataset
+struct chunkBuffers {
+
+    matrix< double > hid, output;
+    matrix< double > inputToHid, inputToOut;
+    matrix< double > deltaOut, deltaHid;
+
+};
+
+
+// Sums of the changes to each weight over the examples given to a thread
+struct weightChanges {
+
+    matrix< double > inHid, hidOut;
+
+};
+
+
+// Fixed set of threads that run the same task, each given its own index
+// The calling thread runs index 0, so a pool of one thread runs tasks directly
+class threadPool {
+
+public:
+
+    threadPool( int );
+    ~threadPool();
+
+    // Runs the task on every thread and waits for all of them to finish
+    void run( const std::function< void( int ) > & );
+
+    // Waits inside a task until every thread of the pool reaches the barrier
+    void barrier();
+
+    int size() const { return workers.size() + 1; }
+
+private:
+
+    // Waits for tasks and runs them until the pool is destroyed
+    void workerLoop( int );
+
+    vector< std::thread > workers;
+    std::mutex lock;
+    std::condition_variable started, finished;
+
+    const std::function< void( int ) > *task;
+    unsigned long generation;       // Number of tasks started
+    int remaining;                  // Number of workers still running the current task
+    bool stopping;
+
+    std::atomic< int > arrived;                     // Number of threads waiting at the barrier
+    std::atomic< unsigned long > barriersPassed;    // Number of times every thread reached the barrier
+
+};
+
+
+// Reads a dataset from disk a chunk of consecutive examples at a time, for datasets too large to load at once
+// A background thread reads the next chunk while the current one is used, so two chunks are in memory at most
+//   Binary datasets are read by seeking to the records of a chunk
+//   Text datasets are scanned once for where each chunk starts, then parsed a chunk at a time
+class dataStream {
+
+public:
+
+    // Opens a dataset, with chunks sized so the two in memory fit in the budget in bytes
+    dataStream( string, size_t );
+    ~dataStream();
+
+    dataStream( const dataStream & ) = delete;
+    dataStream &operator=( const dataStream & ) = delete;
+
+    // Starts reading a chunk in the background
+    void request( int );
+
+    // Waits for the requested chunk and swaps it into the matrices, returning its number of examples
+    //   The matrices given are reused for the next chunk
+    int next( matrix< double > &, matrix< int > & );
+
+    int examples() const { return numEx; }
+    int inputs() const { return numIn; }
+    int outputs() const { return numOut; }
+    int chunks() const { return numChunks; }
+
+private:
+
+    // Finds where each chunk of a text dataset starts
+    void indexText( std::streamoff );
+
+    // Reads a chunk into the buffers of the background thread
+    int readChunk( int );
+
+    // Waits for requests and reads the chunks until the stream is destroyed
+    void prefetchLoop();
+
+    string fileName;
+    ifstream input;                 // Used only by the background thread once the dataset is opened
+    bool binary;
+    int featureType;
+    int numEx, numIn, numOut;
+    int chunkRows, numChunks;
+    vector< std::streamoff > chunkStarts;
+
+    // Chunk being read by the background thread
+    matrix< double > nextInputs;
+    matrix< int > nextOutputs;
+
+    std::thread prefetcher;
+    std::mutex lock;
+    std::condition_variable requested, finished;
+    int pendingChunk;               // Chunk to read, or -1 if none was requested
+    int filledRows;                 // Examples in the chunk read, or -1 if it is not read yet
+    bool stopping;
+
+};
+
+
 class NeuralNetwork {
 
 public:
 
     // Reads a file representing the initial neural network
+    //   The file is either text or a binary model, which is mapped into memory
     NeuralNetwork( string );
 
     // Reads a file representing the training / testing data
+    //   The file is mapped into memory, and is either a binary dataset made by the converter or text, parsed in parallel
     void loadData( string );
 
     // Writes a file representing the weights of the neural network
     void writeWeights( string );
 
+    // Writes the exact weights of the neural network as a binary model
+    void writeBinaryModel( string );
+
     // Writes a file representing metrics for each output class
     void writeMetrics( string );
 
-    // Trains the network according to number of epochs and learning rate
+    // Trains the network according to number of epochs, learning rate, batch size and number of threads
     // Based on Figure 18.24 in the textbook
-    void train( int, double );
+    //   A batch size of 1 updates the weights after every example, as in the textbook
+    //   Larger batch sizes update the weights once per batch, using the average change over the batch
+    //   Threads split each batch by example, and runs with the same number of threads give the same result
+    //   Threads that cannot be given work, such as with a batch size of 1, are left out with a note
+    //   If asynchronous, threads instead train on their own part of the data and update the shared weights without locking (Hogwild)
+    void train( int, double, int, int, bool );
+
+    // Trains the network on a dataset read from disk a chunk at a time, keeping the chunks within a budget in bytes
+    // The order of the chunks is shuffled every epoch, and each chunk is trained on as by train
+    void trainStream( string, size_t, int, double, int, int, bool );
 
     // Tests the network on a given test file
     void test();
@@ -53,12 +454,59 @@ public:
 
 private:
 
-    // Computes activation of a neuron given the activations of the previous layer and weights of connections
-    double activation( vector<double>, vector<double> );
+    // Reads the weights of a text model
+    void readTextModel( ifstream &, string );
+
+    // Maps a binary model, using its weights in place
+    void loadBinaryModel( string );
+
+    // Uses a mapped binary dataset, using its records in place where their layout matches
+    void loadBinaryData( mappedFile &, string );
+
+    // Parses a mapped text dataset in parallel, with values separated by any whitespace
+    void loadTextData( const mappedFile &, string );
+
+    // Exits if the numbers of nodes of a dataset do not match the network
+    void checkNodeCounts( int, int );
+
+    // Computes the weighted sums and activations of a layer given the activations of the previous layer
+    // The sizes of the weights are checked when the network and the data are loaded
+    void forwardLayer( span< const double >, const matrix<double> &, span< double >, span< double > );
 
     // Propagate the inputs forward to compute the outputs
     void computeOutputs( int );
 
+    // Checks how the settings split the work between threads, and allocates the buffers of each thread for batches
+    bool prepareTraining( int, int &, bool );
+
+    // Trains on every example once, updating the weights after each example
+    void trainExamples( double );
+
+    // Trains on every batch of consecutive examples once, with a single update of the weights per batch
+    void trainBatches( threadPool &, double, int, bool );
+
+    // Computes the sums of the changes to each weight over consecutive examples, a chunk at a time
+    void computeRangeChanges( int, int, chunkBuffers &, weightChanges & );
+
+    // Propagate a chunk of inputs forward to compute the outputs, one row per example
+    void computeChunkOutputs( int, int, chunkBuffers & );
+
+    // Computes the sums of the changes to each weight over a chunk of consecutive examples, or adds them to the sums
+    void computeChunkChanges( int, int, chunkBuffers &, weightChanges &, bool );
+
+    // Adds the sums of the changes of the threads to a range of rows of weights
+    //   Rows of weightsInHid come first, followed by rows of weightsHidOut
+    void applyChanges( weightChanges *, int, int, int, double );
+
+    // Matrix products used for batches, blocked to keep the rows in use in cache
+    // Each matrix is given by its first entry and the stride between its rows
+    //   C = A * B^T, the dot products of rows of A with rows of B
+    void multiplyTransposed( const double *, int, const double *, int, double *, int, int, int, int );
+    //   C = A * B
+    void multiply( const double *, int, const double *, int, double *, int, int, int, int );
+    //   C = A^T * B, summing over the rows of A and B, or C += A^T * B
+    void multiplyTransposedSum( const double *, int, const double *, int, double *, int, int, int, int, bool );
+
     // Prints Overall Accuracy, Precision, Recall, F1
     void otherMetrics( ofstream &, int, int, int, int, bool );
     void printMetrics( ofstream &output, double accuracy, double precision, double recall, double F1 );
@@ -66,28 +514,38 @@ private:
     // Trims floating-points to 3 digits after the decimal
     void trimPrecision( ofstream &output, double number );
 
-    // Sigmoid function and derivative of Sigmoid function
-    double sig( double );
+    // Derivative of Sigmoid function, given the activation of the node
+    // The sigmoid itself is computed a layer at a time by the vector kernels
     double sigDeriv( double );
 
     // Neural Network Representation
     int numInNodes, numHidNodes, numOutNodes;               // Number of nodes per layer
-    vector< vector< double > > weightsInHid, weightsHidOut; // Matrix of weights
+    matrix< double > weightsInHid, weightsHidOut;           // Matrix of weights
+    mappedFile modelFile;                                   // Binary model viewed by the weights, if any
 
     // Dataset
+    //   Each row of inputs starts with the fixed input of -1 for the bias weight
     int numEx;
-    vector< vector< double > > inputAttributes;
-    vector< vector< int > > output;
+    matrix< double > inputAttributes;
+    matrix< int > output;
+    mappedFile dataFile;                                    // Binary dataset viewed by the matrices, if any
 
     // Calculates Activations
     //   Stores weighted sum of inputs to each layer
     vector< double > inputToHid;
     vector< double > inputToOut;
     //   Stores activations of each layer
-    vector< double > activationsInput;
+    //   The input layer is a row of the dataset
+    span< const double > activationsInput;
     vector< double > activationsHid;
     vector< double > activationsOutput;
 
+    // Calculates Activations and Deltas for batches
+    //   Stores buffers for each thread
+    vector< chunkBuffers > buffers;
+    //   Stores the sums of the changes over the examples of each thread
+    vector< weightChanges > changes;
+
     // Keeps track of metrics for each output class
     //   Stores A,B,C,D
     vector< vector< int > > metric;
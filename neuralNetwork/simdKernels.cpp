@@ -0,0 +1,891 @@
+#include "neuralNetwork.h"
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+
+using namespace simdVals;
+
+
+// Picks the best instruction set supported by the processor
+// Setting NN_SIMD to "scalar" or "avx2" limits the choice, which is used to compare results
+int detectSimdLevel();
+
+// Checks if the approximate sigmoid was requested by setting NN_SIGMOID to "fast"
+bool fastSigmoidRequested();
+
+// Coefficients of the Taylor polynomial of e^r, 1/n!
+const double EXP_COEFFICIENTS[] = { 1.0, 1.0, 1.0/2, 1.0/6, 1.0/24, 1.0/120, 1.0/720, 1.0/5040, 1.0/40320,
+                                    1.0/362880, 1.0/3628800, 1.0/39916800, 1.0/479001600 };
+
+// Degrees of the polynomial of e^r for each type
+//   The accurate degrees are exact to the precision of the type
+//   The fast degrees bound the error of the sigmoid by 2e-9 for double and 1e-6 for float
+const int EXP_DEGREE_DOUBLE = 12;
+const int EXP_DEGREE_FLOAT = 7;
+const int FAST_EXP_DEGREE_DOUBLE = 7;
+const int FAST_EXP_DEGREE_FLOAT = 5;
+
+
+///////////////////////////////////// Scalar /////////////////////////////////////
+
+// Returns the dot product of two arrays
+template< typename T >
+T dotScalar( const T *a, const T *b, int n ) {
+
+    T sum = 0;
+
+    for ( int i=0; i<n; i++ )
+        sum += a[i] * b[i];
+
+    return sum;
+
+}
+
+
+// Adds the products of the rows of a matrix with a vector to an array
+// Four rows are used at a time, so each entry of the vector is loaded once for four dot products
+template< typename T >
+void matVecScalar( const T *W, int stride, int rows, const T *x, int n, T *out ) {
+
+    int j = 0;
+
+    for ( ; j+4<=rows; j+=4 ) {
+
+        const T *w0 = W + size_t( j ) * stride;
+        const T *w1 = w0 + stride, *w2 = w1 + stride, *w3 = w2 + stride;
+        T sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+
+        for ( int i=0; i<n; i++ ) {
+
+            sum0 += w0[i] * x[i];
+            sum1 += w1[i] * x[i];
+            sum2 += w2[i] * x[i];
+            sum3 += w3[i] * x[i];
+
+        }
+
+        out[j] += sum0;
+        out[j+1] += sum1;
+        out[j+2] += sum2;
+        out[j+3] += sum3;
+
+    }
+
+    for ( ; j<rows; j++ )
+        out[j] += dotScalar( W + size_t( j ) * stride, x, n );
+
+}
+
+
+// Adds a scaled outer product to a matrix
+template< typename T >
+void rank1UpdateScalar( T *W, int stride, int rows, int cols, T scale, const T *u, const T *v ) {
+
+    for ( int j=0; j<rows; j++ ) {
+
+        T *w = W + size_t( j ) * stride;
+
+        for ( int i=0; i<cols; i++ )
+            w[i] += scale * v[i] * u[j];
+
+    }
+
+}
+
+
+// Adds a scaled array to another
+template< typename T >
+void axpyScalar( T *y, int n, T scale, const T *x ) {
+
+    for ( int i=0; i<n; i++ )
+        y[i] += scale * x[i];
+
+}
+
+
+// Applies the sigmoid function to an array
+template< typename T >
+void sigmoidScalar( const T *x, T *out, int n ) {
+
+    for ( int i=0; i<n; i++ )
+        out[i] = 1 / ( 1 + std::exp( -x[i] ) );
+
+}
+
+
+// Computes e^x with a polynomial of the given degree, in the same way as the vector versions
+// Reduces x to r in [-ln2/2, ln2/2], with e^x = 2^k * e^r
+template< int degree >
+double expPoly( double x ) {
+
+    x = std::max( -708.0, std::min( x, 708.0 ) );
+
+    double k = std::nearbyint( x * 1.4426950408889634 );
+    double r = x - k * 6.93147180369123816490e-01 - k * 1.90821492927058770002e-10;
+    double p = EXP_COEFFICIENTS[ degree ];
+
+    for ( int i=degree-1; i>=0; i-- )
+        p = p * r + EXP_COEFFICIENTS[i];
+
+    return std::ldexp( p, int( k ) );
+
+}
+
+template< int degree >
+float expPoly( float x ) {
+
+    x = std::max( -87.0f, std::min( x, 87.0f ) );
+
+    float k = std::nearbyint( x * 1.44269504f );
+    float r = x - k * 0.693359375f - k * -2.12194440e-4f;
+    float p = float( EXP_COEFFICIENTS[ degree ] );
+
+    for ( int i=degree-1; i>=0; i-- )
+        p = p * r + float( EXP_COEFFICIENTS[i] );
+
+    return std::ldexp( p, int( k ) );
+
+}
+
+
+// Applies an approximate sigmoid function to an array
+// e^x is computed with a polynomial of lower degree, bounding the error as given by FAST_EXP_DEGREE_DOUBLE and FAST_EXP_DEGREE_FLOAT
+void fastSigmoidScalar( const double *x, double *out, int n ) {
+
+    for ( int i=0; i<n; i++ )
+        out[i] = 1 / ( 1 + expPoly< FAST_EXP_DEGREE_DOUBLE >( -x[i] ) );
+
+}
+
+void fastSigmoidScalar( const float *x, float *out, int n ) {
+
+    for ( int i=0; i<n; i++ )
+        out[i] = 1 / ( 1 + expPoly< FAST_EXP_DEGREE_FLOAT >( -x[i] ) );
+
+}
+
+
+///////////////////////////////////// AVX2 /////////////////////////////////////
+
+#define AVX2_TARGET __attribute__(( target( "avx2,fma" ) ))
+
+// Returns the sum of the lanes of a vector
+AVX2_TARGET inline double sumLanes( __m256d x ) {
+
+    __m128d half = _mm_add_pd( _mm256_castpd256_pd128( x ), _mm256_extractf128_pd( x, 1 ) );
+    return _mm_cvtsd_f64( _mm_add_sd( half, _mm_unpackhi_pd( half, half ) ) );
+
+}
+
+AVX2_TARGET inline float sumLanes( __m256 x ) {
+
+    __m128 half = _mm_add_ps( _mm256_castps256_ps128( x ), _mm256_extractf128_ps( x, 1 ) );
+    half = _mm_add_ps( half, _mm_movehl_ps( half, half ) );
+    return _mm_cvtss_f32( _mm_add_ss( half, _mm_movehdup_ps( half ) ) );
+
+}
+
+
+// Computes e^x by reducing x to r in [-ln2/2, ln2/2], with e^x = 2^k * e^r
+//   e^r is a Taylor polynomial of the given degree
+//   x is clamped so 2^k stays a normal number
+template< int degree >
+AVX2_TARGET inline __m256d expAvx2( __m256d x ) {
+
+    x = _mm256_max_pd( _mm256_min_pd( x, _mm256_set1_pd( 708.0 ) ), _mm256_set1_pd( -708.0 ) );
+
+    __m256d k = _mm256_round_pd( _mm256_mul_pd( x, _mm256_set1_pd( 1.4426950408889634 ) ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC );
+    __m256d r = _mm256_fnmadd_pd( k, _mm256_set1_pd( 6.93147180369123816490e-01 ), x );
+    r = _mm256_fnmadd_pd( k, _mm256_set1_pd( 1.90821492927058770002e-10 ), r );
+
+    __m256d p = _mm256_set1_pd( EXP_COEFFICIENTS[ degree ] );
+
+    for ( int i=degree-1; i>=0; i-- )
+        p = _mm256_fmadd_pd( p, r, _mm256_set1_pd( EXP_COEFFICIENTS[i] ) );
+
+    __m256i exponent = _mm256_add_epi64( _mm256_cvtepi32_epi64( _mm256_cvtpd_epi32( k ) ), _mm256_set1_epi64x( 1023 ) );
+    return _mm256_mul_pd( p, _mm256_castsi256_pd( _mm256_slli_epi64( exponent, 52 ) ) );
+
+}
+
+template< int degree >
+AVX2_TARGET inline __m256 expAvx2( __m256 x ) {
+
+    x = _mm256_max_ps( _mm256_min_ps( x, _mm256_set1_ps( 87.0f ) ), _mm256_set1_ps( -87.0f ) );
+
+    __m256 k = _mm256_round_ps( _mm256_mul_ps( x, _mm256_set1_ps( 1.44269504f ) ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC );
+    __m256 r = _mm256_fnmadd_ps( k, _mm256_set1_ps( 0.693359375f ), x );
+    r = _mm256_fnmadd_ps( k, _mm256_set1_ps( -2.12194440e-4f ), r );
+
+    __m256 p = _mm256_set1_ps( float( EXP_COEFFICIENTS[ degree ] ) );
+
+    for ( int i=degree-1; i>=0; i-- )
+        p = _mm256_fmadd_ps( p, r, _mm256_set1_ps( float( EXP_COEFFICIENTS[i] ) ) );
+
+    __m256i exponent = _mm256_add_epi32( _mm256_cvtps_epi32( k ), _mm256_set1_epi32( 127 ) );
+    return _mm256_mul_ps( p, _mm256_castsi256_ps( _mm256_slli_epi32( exponent, 23 ) ) );
+
+}
+
+
+AVX2_TARGET double dotAvx2( const double *a, const double *b, int n ) {
+
+    __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+    int i = 0;
+
+    for ( ; i+8<=n; i+=8 ) {
+
+        sum0 = _mm256_fmadd_pd( _mm256_loadu_pd( a+i ), _mm256_loadu_pd( b+i ), sum0 );
+        sum1 = _mm256_fmadd_pd( _mm256_loadu_pd( a+i+4 ), _mm256_loadu_pd( b+i+4 ), sum1 );
+
+    }
+
+    for ( ; i+4<=n; i+=4 )
+        sum0 = _mm256_fmadd_pd( _mm256_loadu_pd( a+i ), _mm256_loadu_pd( b+i ), sum0 );
+
+    double sum = sumLanes( _mm256_add_pd( sum0, sum1 ) );
+
+    for ( ; i<n; i++ )
+        sum += a[i] * b[i];
+
+    return sum;
+
+}
+
+AVX2_TARGET float dotAvx2( const float *a, const float *b, int n ) {
+
+    __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+    int i = 0;
+
+    for ( ; i+16<=n; i+=16 ) {
+
+        sum0 = _mm256_fmadd_ps( _mm256_loadu_ps( a+i ), _mm256_loadu_ps( b+i ), sum0 );
+        sum1 = _mm256_fmadd_ps( _mm256_loadu_ps( a+i+8 ), _mm256_loadu_ps( b+i+8 ), sum1 );
+
+    }
+
+    for ( ; i+8<=n; i+=8 )
+        sum0 = _mm256_fmadd_ps( _mm256_loadu_ps( a+i ), _mm256_loadu_ps( b+i ), sum0 );
+
+    float sum = sumLanes( _mm256_add_ps( sum0, sum1 ) );
+
+    for ( ; i<n; i++ )
+        sum += a[i] * b[i];
+
+    return sum;
+
+}
+
+
+AVX2_TARGET void matVecAvx2( const double *W, int stride, int rows, const double *x, int n, double *out ) {
+
+    int j = 0;
+
+    for ( ; j+4<=rows; j+=4 ) {
+
+        const double *w0 = W + size_t( j ) * stride;
+        const double *w1 = w0 + stride, *w2 = w1 + stride, *w3 = w2 + stride;
+        __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd(), sum2 = _mm256_setzero_pd(), sum3 = _mm256_setzero_pd();
+        int i = 0;
+
+        for ( ; i+4<=n; i+=4 ) {
+
+            __m256d xi = _mm256_loadu_pd( x+i );
+
+            sum0 = _mm256_fmadd_pd( _mm256_loadu_pd( w0+i ), xi, sum0 );
+            sum1 = _mm256_fmadd_pd( _mm256_loadu_pd( w1+i ), xi, sum1 );
+            sum2 = _mm256_fmadd_pd( _mm256_loadu_pd( w2+i ), xi, sum2 );
+            sum3 = _mm256_fmadd_pd( _mm256_loadu_pd( w3+i ), xi, sum3 );
+
+        }
+
+        double total0 = sumLanes( sum0 ), total1 = sumLanes( sum1 ), total2 = sumLanes( sum2 ), total3 = sumLanes( sum3 );
+
+        for ( ; i<n; i++ ) {
+
+            total0 += w0[i] * x[i];
+            total1 += w1[i] * x[i];
+            total2 += w2[i] * x[i];
+            total3 += w3[i] * x[i];
+
+        }
+
+        out[j] += total0;
+        out[j+1] += total1;
+        out[j+2] += total2;
+        out[j+3] += total3;
+
+    }
+
+    for ( ; j<rows; j++ )
+        out[j] += dotAvx2( W + size_t( j ) * stride, x, n );
+
+}
+
+AVX2_TARGET void matVecAvx2( const float *W, int stride, int rows, const float *x, int n, float *out ) {
+
+    int j = 0;
+
+    for ( ; j+4<=rows; j+=4 ) {
+
+        const float *w0 = W + size_t( j ) * stride;
+        const float *w1 = w0 + stride, *w2 = w1 + stride, *w3 = w2 + stride;
+        __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps(), sum2 = _mm256_setzero_ps(), sum3 = _mm256_setzero_ps();
+        int i = 0;
+
+        for ( ; i+8<=n; i+=8 ) {
+
+            __m256 xi = _mm256_loadu_ps( x+i );
+
+            sum0 = _mm256_fmadd_ps( _mm256_loadu_ps( w0+i ), xi, sum0 );
+            sum1 = _mm256_fmadd_ps( _mm256_loadu_ps( w1+i ), xi, sum1 );
+            sum2 = _mm256_fmadd_ps( _mm256_loadu_ps( w2+i ), xi, sum2 );
+            sum3 = _mm256_fmadd_ps( _mm256_loadu_ps( w3+i ), xi, sum3 );
+
+        }
+
+        float total0 = sumLanes( sum0 ), total1 = sumLanes( sum1 ), total2 = sumLanes( sum2 ), total3 = sumLanes( sum3 );
+
+        for ( ; i<n; i++ ) {
+
+            total0 += w0[i] * x[i];
+            total1 += w1[i] * x[i];
+            total2 += w2[i] * x[i];
+            total3 += w3[i] * x[i];
+
+        }
+
+        out[j] += total0;
+        out[j+1] += total1;
+        out[j+2] += total2;
+        out[j+3] += total3;
+
+    }
+
+    for ( ; j<rows; j++ )
+        out[j] += dotAvx2( W + size_t( j ) * stride, x, n );
+
+}
+
+
+AVX2_TARGET void rank1UpdateAvx2( double *W, int stride, int rows, int cols, double scale, const double *u, const double *v ) {
+
+    __m256d scaleVec = _mm256_set1_pd( scale );
+
+    for ( int j=0; j<rows; j++ ) {
+
+        double *w = W + size_t( j ) * stride;
+        __m256d uj = _mm256_set1_pd( u[j] );
+        int i = 0;
+
+        for ( ; i+4<=cols; i+=4 )
+            _mm256_storeu_pd( w+i, _mm256_fmadd_pd( _mm256_mul_pd( scaleVec, _mm256_loadu_pd( v+i ) ), uj, _mm256_loadu_pd( w+i ) ) );
+
+        for ( ; i<cols; i++ )
+            w[i] += scale * v[i] * u[j];
+
+    }
+
+}
+
+AVX2_TARGET void rank1UpdateAvx2( float *W, int stride, int rows, int cols, float scale, const float *u, const float *v ) {
+
+    __m256 scaleVec = _mm256_set1_ps( scale );
+
+    for ( int j=0; j<rows; j++ ) {
+
+        float *w = W + size_t( j ) * stride;
+        __m256 uj = _mm256_set1_ps( u[j] );
+        int i = 0;
+
+        for ( ; i+8<=cols; i+=8 )
+            _mm256_storeu_ps( w+i, _mm256_fmadd_ps( _mm256_mul_ps( scaleVec, _mm256_loadu_ps( v+i ) ), uj, _mm256_loadu_ps( w+i ) ) );
+
+        for ( ; i<cols; i++ )
+            w[i] += scale * v[i] * u[j];
+
+    }
+
+}
+
+
+AVX2_TARGET void axpyAvx2( double *y, int n, double scale, const double *x ) {
+
+    __m256d scaleVec = _mm256_set1_pd( scale );
+    int i = 0;
+
+    for ( ; i+4<=n; i+=4 )
+        _mm256_storeu_pd( y+i, _mm256_fmadd_pd( scaleVec, _mm256_loadu_pd( x+i ), _mm256_loadu_pd( y+i ) ) );
+
+    for ( ; i<n; i++ )
+        y[i] += scale * x[i];
+
+}
+
+AVX2_TARGET void axpyAvx2( float *y, int n, float scale, const float *x ) {
+
+    __m256 scaleVec = _mm256_set1_ps( scale );
+    int i = 0;
+
+    for ( ; i+8<=n; i+=8 )
+        _mm256_storeu_ps( y+i, _mm256_fmadd_ps( scaleVec, _mm256_loadu_ps( x+i ), _mm256_loadu_ps( y+i ) ) );
+
+    for ( ; i<n; i++ )
+        y[i] += scale * x[i];
+
+}
+
+
+template< int degree >
+AVX2_TARGET void sigmoidAvx2( const double *x, double *out, int n ) {
+
+    __m256d one = _mm256_set1_pd( 1.0 );
+    int i = 0;
+
+    for ( ; i+4<=n; i+=4 ) {
+
+        __m256d negX = _mm256_sub_pd( _mm256_setzero_pd(), _mm256_loadu_pd( x+i ) );
+        _mm256_storeu_pd( out+i, _mm256_div_pd( one, _mm256_add_pd( one, expAvx2< degree >( negX ) ) ) );
+
+    }
+
+    if ( degree == EXP_DEGREE_DOUBLE )
+        sigmoidScalar( x+i, out+i, n-i );
+    else
+        fastSigmoidScalar( x+i, out+i, n-i );
+
+}
+
+template< int degree >
+AVX2_TARGET void sigmoidAvx2( const float *x, float *out, int n ) {
+
+    __m256 one = _mm256_set1_ps( 1.0f );
+    int i = 0;
+
+    for ( ; i+8<=n; i+=8 ) {
+
+        __m256 negX = _mm256_sub_ps( _mm256_setzero_ps(), _mm256_loadu_ps( x+i ) );
+        _mm256_storeu_ps( out+i, _mm256_div_ps( one, _mm256_add_ps( one, expAvx2< degree >( negX ) ) ) );
+
+    }
+
+    if ( degree == EXP_DEGREE_FLOAT )
+        sigmoidScalar( x+i, out+i, n-i );
+    else
+        fastSigmoidScalar( x+i, out+i, n-i );
+
+}
+
+
+///////////////////////////////////// AVX-512 /////////////////////////////////////
+// Tails shorter than a vector are handled with masked loads and stores
+// GCC 12 warns about the undefined vectors inside the intrinsics of this section, so those warnings are turned off here
+
+#define AVX512_TARGET __attribute__(( target( "avx512f" ) ))
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+// Returns the mask of the first n lanes
+inline __mmask8 laneMask8( int n ) { return __mmask8( ( 1u << n ) - 1 ); }
+inline __mmask16 laneMask16( int n ) { return __mmask16( ( 1u << n ) - 1 ); }
+
+
+// Computes e^x as in expAvx2, with scalef applying 2^k
+template< int degree >
+AVX512_TARGET inline __m512d expAvx512( __m512d x ) {
+
+    x = _mm512_max_pd( _mm512_min_pd( x, _mm512_set1_pd( 708.0 ) ), _mm512_set1_pd( -708.0 ) );
+
+    __m512d k = _mm512_roundscale_pd( _mm512_mul_pd( x, _mm512_set1_pd( 1.4426950408889634 ) ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC );
+    __m512d r = _mm512_fnmadd_pd( k, _mm512_set1_pd( 6.93147180369123816490e-01 ), x );
+    r = _mm512_fnmadd_pd( k, _mm512_set1_pd( 1.90821492927058770002e-10 ), r );
+
+    __m512d p = _mm512_set1_pd( EXP_COEFFICIENTS[ degree ] );
+
+    for ( int i=degree-1; i>=0; i-- )
+        p = _mm512_fmadd_pd( p, r, _mm512_set1_pd( EXP_COEFFICIENTS[i] ) );
+
+    return _mm512_scalef_pd( p, k );
+
+}
+
+template< int degree >
+AVX512_TARGET inline __m512 expAvx512( __m512 x ) {
+
+    x = _mm512_max_ps( _mm512_min_ps( x, _mm512_set1_ps( 87.0f ) ), _mm512_set1_ps( -87.0f ) );
+
+    __m512 k = _mm512_roundscale_ps( _mm512_mul_ps( x, _mm512_set1_ps( 1.44269504f ) ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC );
+    __m512 r = _mm512_fnmadd_ps( k, _mm512_set1_ps( 0.693359375f ), x );
+    r = _mm512_fnmadd_ps( k, _mm512_set1_ps( -2.12194440e-4f ), r );
+
+    __m512 p = _mm512_set1_ps( float( EXP_COEFFICIENTS[ degree ] ) );
+
+    for ( int i=degree-1; i>=0; i-- )
+        p = _mm512_fmadd_ps( p, r, _mm512_set1_ps( float( EXP_COEFFICIENTS[i] ) ) );
+
+    return _mm512_scalef_ps( p, k );
+
+}
+
+
+AVX512_TARGET double dotAvx512( const double *a, const double *b, int n ) {
+
+    __m512d sum0 = _mm512_setzero_pd(), sum1 = _mm512_setzero_pd();
+    int i = 0;
+
+    for ( ; i+16<=n; i+=16 ) {
+
+        sum0 = _mm512_fmadd_pd( _mm512_loadu_pd( a+i ), _mm512_loadu_pd( b+i ), sum0 );
+        sum1 = _mm512_fmadd_pd( _mm512_loadu_pd( a+i+8 ), _mm512_loadu_pd( b+i+8 ), sum1 );
+
+    }
+
+    for ( ; i+8<=n; i+=8 )
+        sum0 = _mm512_fmadd_pd( _mm512_loadu_pd( a+i ), _mm512_loadu_pd( b+i ), sum0 );
+
+    if ( i < n ) {
+
+        __mmask8 mask = laneMask8( n-i );
+        sum1 = _mm512_fmadd_pd( _mm512_maskz_loadu_pd( mask, a+i ), _mm512_maskz_loadu_pd( mask, b+i ), sum1 );
+
+    }
+
+    return _mm512_reduce_add_pd( _mm512_add_pd( sum0, sum1 ) );
+
+}
+
+AVX512_TARGET float dotAvx512( const float *a, const float *b, int n ) {
+
+    __m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps();
+    int i = 0;
+
+    for ( ; i+32<=n; i+=32 ) {
+
+        sum0 = _mm512_fmadd_ps( _mm512_loadu_ps( a+i ), _mm512_loadu_ps( b+i ), sum0 );
+        sum1 = _mm512_fmadd_ps( _mm512_loadu_ps( a+i+16 ), _mm512_loadu_ps( b+i+16 ), sum1 );
+
+    }
+
+    for ( ; i+16<=n; i+=16 )
+        sum0 = _mm512_fmadd_ps( _mm512_loadu_ps( a+i ), _mm512_loadu_ps( b+i ), sum0 );
+
+    if ( i < n ) {
+
+        __mmask16 mask = laneMask16( n-i );
+        sum1 = _mm512_fmadd_ps( _mm512_maskz_loadu_ps( mask, a+i ), _mm512_maskz_loadu_ps( mask, b+i ), sum1 );
+
+    }
+
+    return _mm512_reduce_add_ps( _mm512_add_ps( sum0, sum1 ) );
+
+}
+
+
+AVX512_TARGET void matVecAvx512( const double *W, int stride, int rows, const double *x, int n, double *out ) {
+
+    int j = 0;
+
+    for ( ; j+4<=rows; j+=4 ) {
+
+        const double *w0 = W + size_t( j ) * stride;
+        const double *w1 = w0 + stride, *w2 = w1 + stride, *w3 = w2 + stride;
+        __m512d sum0 = _mm512_setzero_pd(), sum1 = _mm512_setzero_pd(), sum2 = _mm512_setzero_pd(), sum3 = _mm512_setzero_pd();
+
+        for ( int i=0; i<n; i+=8 ) {
+
+            __mmask8 mask = laneMask8( std::min( 8, n-i ) );
+            __m512d xi = _mm512_maskz_loadu_pd( mask, x+i );
+
+            sum0 = _mm512_fmadd_pd( _mm512_maskz_loadu_pd( mask, w0+i ), xi, sum0 );
+            sum1 = _mm512_fmadd_pd( _mm512_maskz_loadu_pd( mask, w1+i ), xi, sum1 );
+            sum2 = _mm512_fmadd_pd( _mm512_maskz_loadu_pd( mask, w2+i ), xi, sum2 );
+            sum3 = _mm512_fmadd_pd( _mm512_maskz_loadu_pd( mask, w3+i ), xi, sum3 );
+
+        }
+
+        out[j] += _mm512_reduce_add_pd( sum0 );
+        out[j+1] += _mm512_reduce_add_pd( sum1 );
+        out[j+2] += _mm512_reduce_add_pd( sum2 );
+        out[j+3] += _mm512_reduce_add_pd( sum3 );
+
+    }
+
+    for ( ; j<rows; j++ )
+        out[j] += dotAvx512( W + size_t( j ) * stride, x, n );
+
+}
+
+AVX512_TARGET void matVecAvx512( const float *W, int stride, int rows, const float *x, int n, float *out ) {
+
+    int j = 0;
+
+    for ( ; j+4<=rows; j+=4 ) {
+
+        const float *w0 = W + size_t( j ) * stride;
+        const float *w1 = w0 + stride, *w2 = w1 + stride, *w3 = w2 + stride;
+        __m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps(), sum2 = _mm512_setzero_ps(), sum3 = _mm512_setzero_ps();
+
+        for ( int i=0; i<n; i+=16 ) {
+
+            __mmask16 mask = laneMask16( std::min( 16, n-i ) );
+            __m512 xi = _mm512_maskz_loadu_ps( mask, x+i );
+
+            sum0 = _mm512_fmadd_ps( _mm512_maskz_loadu_ps( mask, w0+i ), xi, sum0 );
+            sum1 = _mm512_fmadd_ps( _mm512_maskz_loadu_ps( mask, w1+i ), xi, sum1 );
+            sum2 = _mm512_fmadd_ps( _mm512_maskz_loadu_ps( mask, w2+i ), xi, sum2 );
+            sum3 = _mm512_fmadd_ps( _mm512_maskz_loadu_ps( mask, w3+i ), xi, sum3 );
+
+        }
+
+        out[j] += _mm512_reduce_add_ps( sum0 );
+        out[j+1] += _mm512_reduce_add_ps( sum1 );
+        out[j+2] += _mm512_reduce_add_ps( sum2 );
+        out[j+3] += _mm512_reduce_add_ps( sum3 );
+
+    }
+
+    for ( ; j<rows; j++ )
+        out[j] += dotAvx512( W + size_t( j ) * stride, x, n );
+
+}
+
+
+AVX512_TARGET void rank1UpdateAvx512( double *W, int stride, int rows, int cols, double scale, const double *u, const double *v ) {
+
+    __m512d scaleVec = _mm512_set1_pd( scale );
+
+    for ( int j=0; j<rows; j++ ) {
+
+        double *w = W + size_t( j ) * stride;
+        __m512d uj = _mm512_set1_pd( u[j] );
+
+        for ( int i=0; i<cols; i+=8 ) {
+
+            __mmask8 mask = laneMask8( std::min( 8, cols-i ) );
+            __m512d update = _mm512_fmadd_pd( _mm512_mul_pd( scaleVec, _mm512_maskz_loadu_pd( mask, v+i ) ), uj, _mm512_maskz_loadu_pd( mask, w+i ) );
+            _mm512_mask_storeu_pd( w+i, mask, update );
+
+        }
+
+    }
+
+}
+
+AVX512_TARGET void rank1UpdateAvx512( float *W, int stride, int rows, int cols, float scale, const float *u, const float *v ) {
+
+    __m512 scaleVec = _mm512_set1_ps( scale );
+
+    for ( int j=0; j<rows; j++ ) {
+
+        float *w = W + size_t( j ) * stride;
+        __m512 uj = _mm512_set1_ps( u[j] );
+
+        for ( int i=0; i<cols; i+=16 ) {
+
+            __mmask16 mask = laneMask16( std::min( 16, cols-i ) );
+            __m512 update = _mm512_fmadd_ps( _mm512_mul_ps( scaleVec, _mm512_maskz_loadu_ps( mask, v+i ) ), uj, _mm512_maskz_loadu_ps( mask, w+i ) );
+            _mm512_mask_storeu_ps( w+i, mask, update );
+
+        }
+
+    }
+
+}
+
+
+AVX512_TARGET void axpyAvx512( double *y, int n, double scale, const double *x ) {
+
+    __m512d scaleVec = _mm512_set1_pd( scale );
+
+    for ( int i=0; i<n; i+=8 ) {
+
+        __mmask8 mask = laneMask8( std::min( 8, n-i ) );
+        _mm512_mask_storeu_pd( y+i, mask, _mm512_fmadd_pd( scaleVec, _mm512_maskz_loadu_pd( mask, x+i ), _mm512_maskz_loadu_pd( mask, y+i ) ) );
+
+    }
+
+}
+
+AVX512_TARGET void axpyAvx512( float *y, int n, float scale, const float *x ) {
+
+    __m512 scaleVec = _mm512_set1_ps( scale );
+
+    for ( int i=0; i<n; i+=16 ) {
+
+        __mmask16 mask = laneMask16( std::min( 16, n-i ) );
+        _mm512_mask_storeu_ps( y+i, mask, _mm512_fmadd_ps( scaleVec, _mm512_maskz_loadu_ps( mask, x+i ), _mm512_maskz_loadu_ps( mask, y+i ) ) );
+
+    }
+
+}
+
+
+template< int degree >
+AVX512_TARGET void sigmoidAvx512( const double *x, double *out, int n ) {
+
+    __m512d one = _mm512_set1_pd( 1.0 );
+
+    for ( int i=0; i<n; i+=8 ) {
+
+        __mmask8 mask = laneMask8( std::min( 8, n-i ) );
+        __m512d negX = _mm512_sub_pd( _mm512_setzero_pd(), _mm512_maskz_loadu_pd( mask, x+i ) );
+        _mm512_mask_storeu_pd( out+i, mask, _mm512_div_pd( one, _mm512_add_pd( one, expAvx512< degree >( negX ) ) ) );
+
+    }
+
+}
+
+template< int degree >
+AVX512_TARGET void sigmoidAvx512( const float *x, float *out, int n ) {
+
+    __m512 one = _mm512_set1_ps( 1.0f );
+
+    for ( int i=0; i<n; i+=16 ) {
+
+        __mmask16 mask = laneMask16( std::min( 16, n-i ) );
+        __m512 negX = _mm512_sub_ps( _mm512_setzero_ps(), _mm512_maskz_loadu_ps( mask, x+i ) );
+        _mm512_mask_storeu_ps( out+i, mask, _mm512_div_ps( one, _mm512_add_ps( one, expAvx512< degree >( negX ) ) ) );
+
+    }
+
+}
+
+#pragma GCC diagnostic pop
+
+
+///////////////////////////////////// Dispatch /////////////////////////////////////
+
+// Returns the kernels for an instruction set, with the accurate or approximate sigmoid
+// The instruction set must be supported by the processor
+template< typename T >
+simdKernels< T > kernelsFor( int level, bool fastSigmoid ) {
+
+    const int accurateDegree = sizeof( T ) == sizeof( double ) ? EXP_DEGREE_DOUBLE : EXP_DEGREE_FLOAT;
+    const int fastDegree = sizeof( T ) == sizeof( double ) ? FAST_EXP_DEGREE_DOUBLE : FAST_EXP_DEGREE_FLOAT;
+
+    simdKernels< T > table;
+
+    table.level = level;
+    table.fastSigmoid = fastSigmoid;
+
+    if ( level == SIMD_AVX512 ) {
+
+        table.dot = dotAvx512;
+        table.matVec = matVecAvx512;
+        table.rank1Update = rank1UpdateAvx512;
+        table.axpy = axpyAvx512;
+
+        if ( fastSigmoid )
+            table.sigmoid = sigmoidAvx512< fastDegree >;
+        else
+            table.sigmoid = sigmoidAvx512< accurateDegree >;
+
+    }
+    else if ( level == SIMD_AVX2 ) {
+
+        table.dot = dotAvx2;
+        table.matVec = matVecAvx2;
+        table.rank1Update = rank1UpdateAvx2;
+        table.axpy = axpyAvx2;
+
+        if ( fastSigmoid )
+            table.sigmoid = sigmoidAvx2< fastDegree >;
+        else
+            table.sigmoid = sigmoidAvx2< accurateDegree >;
+
+    }
+    else {
+
+        table.dot = dotScalar< T >;
+        table.matVec = matVecScalar< T >;
+        table.rank1Update = rank1UpdateScalar< T >;
+        table.axpy = axpyScalar< T >;
+
+        if ( fastSigmoid )
+            table.sigmoid = fastSigmoidScalar;
+        else
+            table.sigmoid = sigmoidScalar< T >;
+
+    }
+
+    return table;
+
+}
+
+
+template simdKernels< double > kernelsFor< double >( int, bool );
+template simdKernels< float > kernelsFor< float >( int, bool );
+
+
+// Returns the kernels for the instruction set picked at runtime
+// The instruction set is detected once, on the first call
+template<>
+const simdKernels< double > &kernels< double >() {
+
+    static const simdKernels< double > table = kernelsFor< double >( detectSimdLevel(), fastSigmoidRequested() );
+    return table;
+
+}
+
+template<>
+const simdKernels< float > &kernels< float >() {
+
+    static const simdKernels< float > table = kernelsFor< float >( detectSimdLevel(), fastSigmoidRequested() );
+    return table;
+
+}
+
+
+// Returns the best instruction set supported by the processor
+// The processor is queried with CPUID, which also checks the operating system saves the vector registers
+int supportedSimdLevel() {
+
+    __builtin_cpu_init();
+
+    int level = SIMD_SCALAR;
+
+    if ( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+        level = SIMD_AVX2;
+
+    if ( level == SIMD_AVX2 && __builtin_cpu_supports( "avx512f" ) )
+        level = SIMD_AVX512;
+
+    return level;
+
+}
+
+
+// Picks the best instruction set supported by the processor, limited by NN_SIMD
+int detectSimdLevel() {
+
+    int level = supportedSimdLevel();
+
+    // Limits the instruction set if requested
+    const char *setting = getenv( "NN_SIMD" );
+
+    if ( setting != nullptr ) {
+
+        if ( strcmp( setting, "scalar" ) == 0 )
+            level = SIMD_SCALAR;
+        else if ( strcmp( setting, "avx2" ) == 0 && level > SIMD_AVX2 )
+            level = SIMD_AVX2;
+
+    }
+
+    return level;
+
+}
+
+
+// Checks if the approximate sigmoid was requested by setting NN_SIGMOID to "fast"
+bool fastSigmoidRequested() {
+
+    const char *setting = getenv( "NN_SIGMOID" );
+
+    return setting != nullptr && strcmp( setting, "fast" ) == 0;
+
+}
@@ -0,0 +1,213 @@
+#include "neuralNetwork.h"
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <limits>
+#include <algorithm>
+
+using namespace simdVals;
+
+
+// Checks that every vector kernel agrees with the scalar kernel, for float and double
+// Instruction sets the processor does not support are skipped
+//   Lengths cover every tail shorter than a vector, and matrices are strided, with padding that must not be read or written
+//   Arrays start one entry past an aligned address, so unaligned loads are covered too
+
+
+const int TEST_LENGTHS[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 23, 31, 32, 33, 47, 63, 64, 65, 100, 257 };
+const int TEST_ROWS[] = { 1, 2, 3, 4, 5, 7, 9, 17 };
+const char *LEVEL_NAMES[] = { "scalar", "AVX2", "AVX-512" };
+
+int failures = 0;
+
+
+// Tolerances relative to the size of the terms summed
+//   Vector versions sum in a different order and fuse multiplies and adds
+template< typename T > double sumTolerance();
+template<> double sumTolerance< double >() { return 1e-13; }
+template<> double sumTolerance< float >() { return 1e-5; }
+
+// Largest difference from the exact sigmoid, with the accurate or approximate sigmoid
+template< typename T > double sigmoidTolerance( bool );
+template<> double sigmoidTolerance< double >( bool fast ) { return fast ? 2e-9 : 1e-15; }
+template<> double sigmoidTolerance< float >( bool fast ) { return fast ? 1e-6 : 2e-7; }
+
+
+// Records a failure if two values differ by more than the tolerance times the scale
+void check( bool &ok, double expected, double actual, double tolerance, double scale ) {
+
+    if ( !( std::fabs( expected - actual ) <= tolerance * std::max( scale, 1.0 ) ) )
+        ok = false;
+
+}
+
+
+// Prints the result of a test and counts failures
+void report( bool ok, const string &name, const char *type, int level, int n ) {
+
+    if ( !ok ) {
+
+        std::cerr << "FAIL: " << name << "<" << type << "> " << LEVEL_NAMES[ level ] << " length " << n << "\n";
+        failures++;
+
+    }
+
+}
+
+
+// Fills an array with random values in [-1, 1]
+template< typename T >
+vector< T > randomValues( std::default_random_engine &generator, int n ) {
+
+    std::uniform_real_distribution< double > unif( -1, 1 );
+    vector< T > values( n );
+
+    for ( T &iter : values )
+        iter = T( unif( generator ) );
+
+    return values;
+
+}
+
+
+template< typename T >
+void testKernels( const char *type, int level, std::default_random_engine &generator ) {
+
+    const simdKernels< T > scalar = kernelsFor< T >( SIMD_SCALAR, false );
+    const simdKernels< T > simd = kernelsFor< T >( level, false );
+    const simdKernels< T > fast = kernelsFor< T >( level, true );
+    const T padding = std::numeric_limits< T >::quiet_NaN();
+
+    for ( int n : TEST_LENGTHS ) {
+
+        // Offset by one so the arrays are not aligned
+        std::vector< T > a = randomValues< T >( generator, n+1 ), b = randomValues< T >( generator, n+1 );
+        double scale = 0;
+
+        for ( int i=0; i<n; i++ )
+            scale += std::fabs( double( a[i+1] ) * b[i+1] );
+
+        // Dot product
+        bool ok = true;
+        check( ok, scalar.dot( a.data()+1, b.data()+1, n ), simd.dot( a.data()+1, b.data()+1, n ), sumTolerance< T >(), scale );
+        report( ok, "dot", type, level, n );
+
+        // Scaled sum
+        ok = true;
+        std::vector< T > y1 = randomValues< T >( generator, n+1 ), y2 = y1;
+        scalar.axpy( y1.data()+1, n, T( 0.37 ), a.data()+1 );
+        simd.axpy( y2.data()+1, n, T( 0.37 ), a.data()+1 );
+
+        for ( int i=0; i<n; i++ )
+            check( ok, y1[i+1], y2[i+1], sumTolerance< T >(), 1 );
+
+        check( ok, y1[0], y2[0], 0, 1 );
+        report( ok, "axpy", type, level, n );
+
+        // Sigmoid, over a wider range than the random values, against the exact sigmoid
+        std::vector< T > x( n+1 ), out( n+1 ), outFast( n+1 );
+
+        for ( int i=0; i<=n; i++ )
+            x[i] = T( 40 * a[i] );
+
+        simd.sigmoid( x.data()+1, out.data()+1, n );
+        fast.sigmoid( x.data()+1, outFast.data()+1, n );
+
+        bool okFast = true;
+        ok = true;
+
+        for ( int i=1; i<=n; i++ ) {
+
+            double exact = 1 / ( 1 + std::exp( -double( x[i] ) ) );
+            check( ok, exact, out[i], sigmoidTolerance< T >( false ), 1 );
+            check( okFast, exact, outFast[i], sigmoidTolerance< T >( true ), 1 );
+
+        }
+
+        report( ok, "sigmoid", type, level, n );
+        report( okFast, "fast sigmoid", type, level, n );
+
+        for ( int rows : TEST_ROWS ) {
+
+            // Rows are padded with NaN, so reading past a row spoils the result
+            int stride = n + 3;
+            std::vector< T > W = randomValues< T >( generator, rows * stride + 1 );
+
+            for ( int j=0; j<rows; j++ )
+                std::fill( W.begin() + 1 + j*stride + n, W.begin() + 1 + ( j+1 )*stride, padding );
+
+            // Products of the rows with a vector, added to an array
+            ok = true;
+            std::vector< T > out1 = randomValues< T >( generator, rows ), out2 = out1;
+            scalar.matVec( W.data()+1, stride, rows, a.data()+1, n, out1.data() );
+            simd.matVec( W.data()+1, stride, rows, a.data()+1, n, out2.data() );
+
+            for ( int j=0; j<rows; j++ ) {
+
+                double rowScale = 1;
+
+                for ( int i=0; i<n; i++ )
+                    rowScale += std::fabs( double( W[ 1 + j*stride + i ] ) * a[i+1] );
+
+                check( ok, out1[j], out2[j], sumTolerance< T >(), rowScale );
+
+            }
+
+            report( ok, "matVec (" + std::to_string( rows ) + " rows)", type, level, n );
+
+            // Outer product added to the rows, which must leave the padding alone
+            ok = true;
+            std::vector< T > W1 = W, W2 = W, u = randomValues< T >( generator, rows );
+            scalar.rank1Update( W1.data()+1, stride, rows, n, T( -0.61 ), u.data(), a.data()+1 );
+            simd.rank1Update( W2.data()+1, stride, rows, n, T( -0.61 ), u.data(), a.data()+1 );
+
+            for ( int j=0; j<rows; j++ ) {
+
+                for ( int i=0; i<stride; i++ ) {
+
+                    T expected = W1[ 1 + j*stride + i ], actual = W2[ 1 + j*stride + i ];
+
+                    if ( i < n )
+                        check( ok, expected, actual, sumTolerance< T >(), 1 );
+                    else if ( !std::isnan( actual ) )
+                        ok = false;
+
+                }
+
+            }
+
+            report( ok, "rank1Update (" + std::to_string( rows ) + " rows)", type, level, n );
+
+        }
+
+    }
+
+}
+
+
+int main() {
+
+    std::default_random_engine generator;
+    int supported = supportedSimdLevel();
+
+    for ( int level=SIMD_SCALAR; level<=SIMD_AVX512; level++ ) {
+
+        if ( level > supported ) {
+
+            cout << LEVEL_NAMES[ level ] << ": skipped, not supported by this processor" << "\n";
+            continue;
+
+        }
+
+        int before = failures;
+
+        testKernels< double >( "double", level, generator );
+        testKernels< float >( "float", level, generator );
+
+        cout << LEVEL_NAMES[ level ] << ": " << ( failures == before ? "passed" : "FAILED" ) << "\n";
+
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
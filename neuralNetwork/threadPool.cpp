@@ -0,0 +1,122 @@
+#include "neuralNetwork.h"
+
+using std::unique_lock;
+using std::lock_guard;
+using std::mutex;
+
+
+// Starts the worker threads
+// The calling thread is the first thread of the pool, so one fewer worker is started
+threadPool::threadPool( int numThreads ) {
+
+    task = nullptr;
+    generation = 0;
+    remaining = 0;
+    stopping = false;
+    arrived = 0;
+    barriersPassed = 0;
+
+    for ( int i=1; i<numThreads; i++ )
+        workers.emplace_back( &threadPool::workerLoop, this, i );
+
+}
+
+
+// Stops and joins the worker threads
+threadPool::~threadPool() {
+
+    {
+        lock_guard< mutex > guard( lock );
+        stopping = true;
+    }
+
+    started.notify_all();
+
+    for ( std::thread &iter : workers )
+        iter.join();
+
+}
+
+
+// Runs the task on every thread and waits for all of them to finish
+void threadPool::run( const std::function< void( int ) > &newTask ) {
+
+    if ( workers.empty() ) {
+
+        newTask( 0 );
+        return;
+
+    }
+
+    {
+        lock_guard< mutex > guard( lock );
+        task = &newTask;
+        remaining = workers.size();
+        generation++;
+    }
+
+    started.notify_all();
+
+    newTask( 0 );
+
+    unique_lock< mutex > guard( lock );
+    finished.wait( guard, [this]() { return remaining == 0; } );
+
+}
+
+
+// Waits inside a task until every thread of the pool reaches the barrier
+// Threads spin, yielding the processor, rather than sleeping, since barriers within a task are close together
+//   The last thread to arrive resets the count before letting the others pass, so the barrier can be used again at once
+void threadPool::barrier() {
+
+    if ( workers.empty() )
+        return;
+
+    unsigned long passed = barriersPassed.load( std::memory_order_acquire );
+
+    if ( arrived.fetch_add( 1, std::memory_order_acq_rel ) == size() - 1 ) {
+
+        arrived.store( 0, std::memory_order_relaxed );
+        barriersPassed.fetch_add( 1, std::memory_order_release );
+
+    }
+    else {
+
+        while ( barriersPassed.load( std::memory_order_acquire ) == passed )
+            std::this_thread::yield();
+
+    }
+
+}
+
+
+// Waits for tasks and runs them until the pool is destroyed
+void threadPool::workerLoop( int index ) {
+
+    unsigned long seen = 0;
+    const std::function< void( int ) > *curTask;
+
+    while ( true ) {
+
+        {
+            unique_lock< mutex > guard( lock );
+            started.wait( guard, [&]() { return stopping || generation != seen; } );
+
+            if ( stopping )
+                return;
+
+            seen = generation;
+            curTask = task;
+        }
+
+        (*curTask)( index );
+
+        lock_guard< mutex > guard( lock );
+
+        if ( --remaining == 0 )
+            finished.notify_one();
+
+    }
+
+}